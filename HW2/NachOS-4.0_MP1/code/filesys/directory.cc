@@ -23,6 +23,9 @@
 
 #include "copyright.h"
 #include "filehdr.h"
+#include "inode.h"
+#include "main.h"
+#include "synchdisk.h"
 #include "utility.h"
 
 //----------------------------------------------------------------------
@@ -59,6 +62,7 @@ Directory::~Directory() {
 //----------------------------------------------------------------------
 
 void Directory::FetchFrom(OpenFile *file) {
+    DiskLayerScope scope(LayerDirectory);
     (void)file->ReadAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
 }
 
@@ -70,6 +74,7 @@ void Directory::FetchFrom(OpenFile *file) {
 //----------------------------------------------------------------------
 
 void Directory::WriteBack(OpenFile *file) {
+    DiskLayerScope scope(LayerDirectory);
     (void)file->WriteAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
 }
 
@@ -178,14 +183,25 @@ bool Directory::Remove(int index) {
     return TRUE;
 }
 
-bool Directory::RemoveRecursive(PersistentBitmap *freeMap) {
+//----------------------------------------------------------------------
+// Directory::RemoveRecursive
+// 	Remove every file and directory inside this directory, freeing
+//	their headers and data blocks.  None of them may be open (see
+//	AnyOpenRecursive).  Return the number of files and
+//	directories removed, so the caller can keep the i-node count.
+//
+//	"freeMap" is the bit map of free disk sectors
+//----------------------------------------------------------------------
+
+int Directory::RemoveRecursive(PersistentBitmap *freeMap) {
+    int numRemoved = 0;
     for (int i = 0; i < tableSize; i++)
         if (table[i].inUse) {
             if (table[i].fileType == DIR_TYPE) {
                 OpenFile *removeDirFile = new OpenFile(table[i].sector);
                 Directory *removeDir = new Directory(NumDirEntries);
                 removeDir->FetchFrom(removeDirFile);
-                removeDir->RemoveRecursive(freeMap);
+                numRemoved += removeDir->RemoveRecursive(freeMap);
                 removeDir->WriteBack(removeDirFile);
                 delete removeDirFile;
                 delete removeDir;
@@ -194,7 +210,7 @@ bool Directory::RemoveRecursive(PersistentBitmap *freeMap) {
                 fileHdr->FetchFrom(table[i].sector);
                 fileHdr->Deallocate(freeMap);  // remove data blocks
                 freeMap->Clear(table[i].sector);        // remove header block
-                Remove(table[i].sector);                // flush to disk
+                Remove(i);
                 delete fileHdr;
             }
             else {
@@ -202,10 +218,62 @@ bool Directory::RemoveRecursive(PersistentBitmap *freeMap) {
                 fileHdr->FetchFrom(table[i].sector);
                 fileHdr->Deallocate(freeMap);  // remove data blocks
                 freeMap->Clear(table[i].sector);        // remove header block
-                Remove(table[i].sector);                // flush to disk
+                Remove(i);
                 delete fileHdr;
             }
+            numRemoved++;
+        }
+    return numRemoved;
+}
+
+//----------------------------------------------------------------------
+// Directory::NumFilesRecursive
+// 	Return the number of files and directories inside this directory,
+//	counting the contents of sub-directories too.
+//----------------------------------------------------------------------
+
+int Directory::NumFilesRecursive() {
+    int numFiles = 0;
+    for (int i = 0; i < tableSize; i++)
+        if (table[i].inUse) {
+            if (table[i].fileType == DIR_TYPE) {
+                OpenFile *subDirFile = new OpenFile(table[i].sector);
+                Directory *subDir = new Directory(NumDirEntries);
+                subDir->FetchFrom(subDirFile);
+                numFiles += subDir->NumFilesRecursive();
+                delete subDir;
+                delete subDirFile;
+            }
+            numFiles++;
+        }
+    return numFiles;
+}
+
+//----------------------------------------------------------------------
+// Directory::AnyOpenRecursive
+// 	Return TRUE if any file or directory inside this directory,
+//	looking inside sub-directories too, is open.  Such a directory
+//	can't be removed: its open files' headers would be freed while
+//	the inode table still has them.
+//----------------------------------------------------------------------
+
+bool Directory::AnyOpenRecursive() {
+    bool open = FALSE;
+    for (int i = 0; i < tableSize && !open; i++)
+        if (table[i].inUse) {
+            if (kernel->inodeTable->IsOpen(table[i].sector)) {
+                open = TRUE;
+            }
+            else if (table[i].fileType == DIR_TYPE) {
+                OpenFile *subDirFile = new OpenFile(table[i].sector);
+                Directory *subDir = new Directory(NumDirEntries);
+                subDir->FetchFrom(subDirFile);
+                open = subDir->AnyOpenRecursive();
+                delete subDir;
+                delete subDirFile;
+            }
         }
+    return open;
 }
 
 //----------------------------------------------------------------------
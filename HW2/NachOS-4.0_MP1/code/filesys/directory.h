@@ -83,7 +83,12 @@ class Directory {
 
     bool Remove(int index);  // Remove a file from the directory by entry index
 
-    bool RemoveRecursive(PersistentBitmap *freeMap);   // Remove everything inside this dir
+    int RemoveRecursive(PersistentBitmap *freeMap);   // Remove everything inside this dir,
+                                                      // return how many files/dirs were removed
+
+    int NumFilesRecursive();  // Count the files and dirs inside this dir
+
+    bool AnyOpenRecursive();  // Is a file or dir inside this dir open?
 
     void List();  // Print the names of all the files
                   //  in the directory
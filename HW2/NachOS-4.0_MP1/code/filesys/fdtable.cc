@@ -0,0 +1,96 @@
+// fdtable.cc
+//	Routines to manage a per-process table of open file descriptors.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "debug.h"
+#include "fdtable.h"
+
+//----------------------------------------------------------------------
+// FileDescriptorTable::FileDescriptorTable
+// 	Initialize a table with no files open.  Every descriptor from
+//	FirstFileId on is put on the free list, lowest first.
+//
+//	"size" is the number of descriptors, including the console ones
+//----------------------------------------------------------------------
+
+FileDescriptorTable::FileDescriptorTable(int size) {
+    ASSERT(size > FirstFileId);
+    tableSize = size;
+    table = new OpenFile *[size];
+    nextFree = new int[size];
+    for (int i = 0; i < size; i++) {
+        table[i] = NULL;
+        nextFree[i] = (i + 1 < size) ? i + 1 : -1;
+    }
+    firstFree = FirstFileId;
+}
+
+//----------------------------------------------------------------------
+// FileDescriptorTable::~FileDescriptorTable
+// 	Close whatever files the process left open, and de-allocate
+//	the table.
+//----------------------------------------------------------------------
+
+FileDescriptorTable::~FileDescriptorTable() {
+    for (int i = FirstFileId; i < tableSize; i++) {
+        if (table[i] != NULL) {
+            delete table[i];
+        }
+    }
+    delete[] table;
+    delete[] nextFree;
+}
+
+//----------------------------------------------------------------------
+// FileDescriptorTable::Add
+// 	Take a descriptor off the free list for "file".  Return the
+//	descriptor, or -1 if every descriptor is in use.
+//
+//	"file" is the newly opened file
+//----------------------------------------------------------------------
+
+OpenFileId FileDescriptorTable::Add(OpenFile *file) {
+    ASSERT(file != NULL);
+    if (firstFree == -1) {
+        return -1;  // table is full
+    }
+    OpenFileId fd = firstFree;
+    firstFree = nextFree[fd];
+    table[fd] = file;
+    return fd;
+}
+
+//----------------------------------------------------------------------
+// FileDescriptorTable::Get
+// 	Return the open file behind "fd", or NULL if "fd" is out of
+//	range or not open.
+//----------------------------------------------------------------------
+
+OpenFile *FileDescriptorTable::Get(OpenFileId fd) {
+    if (fd < FirstFileId || fd >= tableSize) {
+        return NULL;
+    }
+    return table[fd];
+}
+
+//----------------------------------------------------------------------
+// FileDescriptorTable::Close
+// 	Close the file behind "fd" and put "fd" back on the free list.
+//	Return FALSE if "fd" wasn't open.
+//----------------------------------------------------------------------
+
+bool FileDescriptorTable::Close(OpenFileId fd) {
+    OpenFile *file = Get(fd);
+    if (file == NULL) {
+        return FALSE;
+    }
+    delete file;
+    table[fd] = NULL;
+    nextFree[fd] = firstFree;
+    firstFree = fd;
+    return TRUE;
+}
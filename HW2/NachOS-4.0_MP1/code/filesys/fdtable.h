@@ -0,0 +1,50 @@
+// fdtable.h
+//	Data structures for a per-process table of open file descriptors.
+//
+//	A user program refers to the files it has open by small integers
+//	(OpenFileId's).  Every address space keeps its own table mapping
+//	them to OpenFile objects, so two programs opening files can never
+//	clobber each other's descriptors.  Ids 0 and 1 are reserved for
+//	the console (see syscall.h); the first file opened gets id 2.
+//
+//	The table is a plain array indexed by descriptor; the free slots
+//	are chained into a free list through the same array, so opening,
+//	looking up and closing a descriptor are all O(1).
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef FDTABLE_H
+#define FDTABLE_H
+
+#include "copyright.h"
+#include "openfile.h"
+
+typedef int OpenFileId;
+
+#define FirstFileId 2    // 0 and 1 are the console
+#define MaxOpenFiles 20  // per process, console included
+
+class FileDescriptorTable {
+   public:
+    FileDescriptorTable(int size);  // Initialize an empty table with
+                                    // room for "size" descriptors
+    ~FileDescriptorTable();         // Close every file still open,
+                                    // and de-allocate the table
+
+    OpenFileId Add(OpenFile *file);  // Give "file" a descriptor;
+                                     // return -1 if the table is full
+    OpenFile *Get(OpenFileId fd);    // Return the file behind "fd",
+                                     // or NULL if "fd" isn't open
+    bool Close(OpenFileId fd);       // Close "fd" and free its slot;
+                                     // return FALSE if it isn't open
+
+   private:
+    int tableSize;     // Number of descriptors, console included
+    OpenFile **table;  // The open file behind each descriptor
+    int *nextFree;     // Free list, chained by descriptor
+    int firstFree;     // Head of the free list, -1 if the table is full
+};
+
+#endif  // FDTABLE_H
@@ -4,11 +4,11 @@
 //
 //	The file header is used to locate where on disk the
 //	file's data is stored.  We implement this as a fixed size
-//	table of pointers -- each entry in the table points to the
-//	disk sector containing that portion of the file data
-//	(in other words, there are no indirect or doubly indirect
-//	blocks). The table size is chosen so that the file header
-//	will be just big enough to fit in one disk sector,
+//	table of pointers.  For a small (LEVEL_1) file each entry points
+//	straight at the disk sector containing that portion of the file
+//	data; bigger files need single, double or triple indirect blocks
+//	behind every entry. The table size is chosen so that the file 
+//	header will be just big enough to fit in one disk sector,
 //
 //      Unlike in a real system, we do not keep track of file permissions,
 //	ownership, last modification date, etc., in the file header.
@@ -35,9 +35,6 @@ DataPointerInterface::~DataPointerInterface() {
 
 DataPointerInterface* GetNewPointerByLevel(int level) {
     switch (level) {
-        case LEVEL_1:
-            return new DirectPointer();
-            break;
         case LEVEL_2:
             return new SingleIndirectPointer();
             break;
@@ -48,57 +45,17 @@ DataPointerInterface* GetNewPointerByLevel(int level) {
             return new TripleIndirectPointer();
             break;
         default:
-            return nullptr; // impossible case
+            return nullptr; // LEVEL_1 points at data directly, no pointer object
             break;
     }
 }
 
-DirectPointer::~DirectPointer() {
-    // not necessary to do anything
-}
-
-bool DirectPointer::Allocate(PersistentBitmap *freeMap, int numSectors) {
-    ASSERT(numSectors == 1);  // because directPointer must  only have 1
-    if (freeMap->NumClear() < numSectors) {
-        return false;  // not enough space for pointer
-    }
-    dataSector = freeMap->FindAndSet();
-    ASSERT(dataSector >= 0);
-    return true;
-}
-
-void DirectPointer::Deallocate(PersistentBitmap *freeMap) {
-    ASSERT(freeMap->Test((int)dataSector));  // ought to be marked!
-    freeMap->Clear((int)dataSector);
-}
-
-void DirectPointer::FetchFrom(int sectorNumber) {
-    int cacheArraySize = SectorSize / sizeof(int);
-    int cache[cacheArraySize];
-    memset(cache, -1, sizeof(cache));
-    kernel->synchDisk->ReadSector(sectorNumber, (char *)cache);
-    dataSector = cache[0];
-}
-
-void DirectPointer::WriteBack(int sectorNumber) {
-    int cacheArraySize = SectorSize / sizeof(int);
-    int cache[cacheArraySize];
-    memset(cache, -1, sizeof(cache));
-    cache[0] = dataSector;
-    kernel->synchDisk->WriteSector(sectorNumber, (char *)cache);
-}
-
-int DirectPointer::ByteToSector(int offset) {
-    ASSERT(offset <= SectorSize);
-    return dataSector;  // because for direct pointer, only have one dataSector
-}
-
 SingleIndirectPointer::~SingleIndirectPointer() {
     // not necessary to do anything
 }
 
 bool SingleIndirectPointer::Allocate(PersistentBitmap *freeMap, int numSectors) {
-    ASSERT(numSectors <= LEVEL_1_SECTOR_NUM);  // because directPointer must  only have 1
+    ASSERT(numSectors <= SECTOR_NUM_PER_POINTER[LEVEL_2]);
     numPointer = numSectors;
     if (freeMap->NumClear() < numPointer) {
         return false;  // not enough space for pointer
@@ -107,27 +64,18 @@ bool SingleIndirectPointer::Allocate(PersistentBitmap *freeMap, int numSectors)
         pointerSectors[i] = freeMap->FindAndSet();
         ASSERT(pointerSectors[i] >= 0);
     }
-
-    // int remainSector = numSectors;
-    // for (int i = 0; i < numPointer; i++) {
-    //     ASSERT(remainSector > 0);
-    //     int allocateSectors = min(remainSector, SECTOR_NUM_IN_LEVEL[0]);
-    //     ASSERT(table[i].Allocate(freeMap, allocateSectors));
-    //     remainSector -= allocateSectors;
-    // }
-    // ASSERT(remainSector == 0);
     return true;
 }
 
 void SingleIndirectPointer::Deallocate(PersistentBitmap *freeMap) {
     for (int i = 0; i < numPointer; i++) {
-        // table[i].Deallocate(freeMap);
         ASSERT(freeMap->Test((int)pointerSectors[i]));  // ought to be marked!
         freeMap->Clear((int)pointerSectors[i]);
     }
 }
 
 void SingleIndirectPointer::FetchFrom(int sectorNumber) {
+    DiskLayerScope scope(LayerHeader);
     int cacheArraySize = SectorSize / sizeof(int);
     int cache[cacheArraySize];
     memset(cache, -1, sizeof(cache));
@@ -136,13 +84,10 @@ void SingleIndirectPointer::FetchFrom(int sectorNumber) {
     for(int i = 0; i < NUM_INDIRECT_POINTER; i++) {
         pointerSectors[i] = cache[1 + i];
     }
-    // for(int i = 0; i < numPointer; i++) {
-    //     ASSERT(pointerSectors[i] >= 0);
-    //     table[i].FetchFrom(pointerSectors[i]);
-    // }
 }
 
 void SingleIndirectPointer::WriteBack(int sectorNumber) {
+    DiskLayerScope scope(LayerHeader);
     int cacheArraySize = SectorSize / sizeof(int);
     int cache[cacheArraySize];
     memset(cache, -1, sizeof(cache));
@@ -150,29 +95,35 @@ void SingleIndirectPointer::WriteBack(int sectorNumber) {
     for(int i = 0; i < NUM_INDIRECT_POINTER; i++) {
         cache[1 + i] = pointerSectors[i];
     }
-    // for(int i = 0; i < numPointer; i++) {
-    //     ASSERT(pointerSectors[i] >= 0);
-    //     table[i].WriteBack(pointerSectors[i]);
-    // }
     kernel->synchDisk->WriteSector(sectorNumber, (char *)cache);
 }
 
 int SingleIndirectPointer::ByteToSector(int offset) {
-    int pointerIndex = divRoundDown(offset, SIZE_IN_LEVEL[0]);
-    int newOffset = offset % SIZE_IN_LEVEL[0];
-    ASSERT(pointerIndex < NUM_INDIRECT_POINTER);
+    int pointerIndex = divRoundDown(offset, SectorSize);
+    ASSERT(pointerIndex < numPointer);
     ASSERT(pointerSectors[pointerIndex] >= 0);
-    // return table[pointerIndex].ByteToSector(newOffset);
     return pointerSectors[pointerIndex];
 }
 
+DoubleIndirectPointer::DoubleIndirectPointer() {
+    numPointer = 0;
+    for (int i = 0; i < NUM_INDIRECT_POINTER; i++) {
+        table[i] = nullptr;
+    }
+}
+
 DoubleIndirectPointer::~DoubleIndirectPointer() {
-    // not necessary to do anything
+    for (int i = 0; i < NUM_INDIRECT_POINTER; i++) {
+        if (table[i] != nullptr) {
+            delete table[i];
+            table[i] = nullptr;
+        }
+    }
 }
 
 bool DoubleIndirectPointer::Allocate(PersistentBitmap *freeMap, int numSectors) {
-    ASSERT(numSectors <= LEVEL_2_SECTOR_NUM);  // because directPointer must  only have 1
-    numPointer = divRoundUp(numSectors, LEVEL_1_SECTOR_NUM);
+    ASSERT(numSectors <= SECTOR_NUM_PER_POINTER[LEVEL_3]);
+    numPointer = divRoundUp(numSectors, SECTOR_NUM_PER_POINTER[LEVEL_2]);
     if (freeMap->NumClear() < numPointer) {
         return false;  // not enough space for pointer
     }
@@ -184,8 +135,10 @@ bool DoubleIndirectPointer::Allocate(PersistentBitmap *freeMap, int numSectors)
     int remainSector = numSectors;
     for (int i = 0; i < numPointer; i++) {
         ASSERT(remainSector > 0);
-        int allocateSectors = min(remainSector, SECTOR_NUM_IN_LEVEL[1]);
-        ASSERT(table[i].Allocate(freeMap, allocateSectors));
+        int allocateSectors = min(remainSector, SECTOR_NUM_PER_POINTER[LEVEL_2]);
+        if (table[i] != nullptr) delete table[i];
+        table[i] = new SingleIndirectPointer();
+        ASSERT(table[i]->Allocate(freeMap, allocateSectors));
         remainSector -= allocateSectors;
     }
     ASSERT(remainSector == 0);
@@ -194,11 +147,17 @@ bool DoubleIndirectPointer::Allocate(PersistentBitmap *freeMap, int numSectors)
 
 void DoubleIndirectPointer::Deallocate(PersistentBitmap *freeMap) {
     for (int i = 0; i < numPointer; i++) {
-        table[i].Deallocate(freeMap);
+        table[i]->Deallocate(freeMap);
+        delete table[i];
+        table[i] = nullptr;
+
+        ASSERT(freeMap->Test((int)pointerSectors[i]));  // ought to be marked!
+        freeMap->Clear((int)pointerSectors[i]);
     }
 }
 
 void DoubleIndirectPointer::FetchFrom(int sectorNumber) {
+    DiskLayerScope scope(LayerHeader);
     int cacheArraySize = SectorSize / sizeof(int);
     int cache[cacheArraySize];
     memset(cache, -1, sizeof(cache));
@@ -209,11 +168,14 @@ void DoubleIndirectPointer::FetchFrom(int sectorNumber) {
     }
     for(int i = 0; i < numPointer; i++) {
         ASSERT(pointerSectors[i] >= 0);
-        table[i].FetchFrom(pointerSectors[i]);
+        if (table[i] != nullptr) delete table[i];
+        table[i] = new SingleIndirectPointer();
+        table[i]->FetchFrom(pointerSectors[i]);
     }
 }
 
 void DoubleIndirectPointer::WriteBack(int sectorNumber) {
+    DiskLayerScope scope(LayerHeader);
     int cacheArraySize = SectorSize / sizeof(int);
     int cache[cacheArraySize];
     memset(cache, -1, sizeof(cache));
@@ -223,26 +185,38 @@ void DoubleIndirectPointer::WriteBack(int sectorNumber) {
     }
     for(int i = 0; i < numPointer; i++) {
         ASSERT(pointerSectors[i] >= 0);
-        table[i].WriteBack(pointerSectors[i]);
+        table[i]->WriteBack(pointerSectors[i]);
     }
     kernel->synchDisk->WriteSector(sectorNumber, (char *)cache);
 }
 
 int DoubleIndirectPointer::ByteToSector(int offset) {
-    int pointerIndex = divRoundDown(offset, SIZE_IN_LEVEL[1]);
-    int newOffset = offset % SIZE_IN_LEVEL[1];
-    ASSERT(pointerIndex < NUM_INDIRECT_POINTER);
+    int pointerIndex = divRoundDown(offset, SIZE_PER_POINTER[LEVEL_2]);
+    int newOffset = offset % SIZE_PER_POINTER[LEVEL_2];
+    ASSERT(pointerIndex < numPointer);
     ASSERT(pointerSectors[pointerIndex] >= 0);
-    return table[pointerIndex].ByteToSector(newOffset);
+    return table[pointerIndex]->ByteToSector(newOffset);
+}
+
+TripleIndirectPointer::TripleIndirectPointer() {
+    numPointer = 0;
+    for (int i = 0; i < NUM_INDIRECT_POINTER; i++) {
+        table[i] = nullptr;
+    }
 }
 
 TripleIndirectPointer::~TripleIndirectPointer() {
-    // not necessary to do anything
+    for (int i = 0; i < NUM_INDIRECT_POINTER; i++) {
+        if (table[i] != nullptr) {
+            delete table[i];
+            table[i] = nullptr;
+        }
+    }
 }
 
 bool TripleIndirectPointer::Allocate(PersistentBitmap *freeMap, int numSectors) {
-    ASSERT(numSectors <= LEVEL_3_SECTOR_NUM);  // because directPointer must  only have 1
-    numPointer = divRoundUp(numSectors, LEVEL_2_SECTOR_NUM);
+    ASSERT(numSectors <= SECTOR_NUM_PER_POINTER[LEVEL_4]);
+    numPointer = divRoundUp(numSectors, SECTOR_NUM_PER_POINTER[LEVEL_3]);
     if (freeMap->NumClear() < numPointer) {
         return false;  // not enough space for pointer
     }
@@ -254,8 +228,10 @@ bool TripleIndirectPointer::Allocate(PersistentBitmap *freeMap, int numSectors)
     int remainSector = numSectors;
     for (int i = 0; i < numPointer; i++) {
         ASSERT(remainSector > 0);
-        int allocateSectors = min(remainSector, SECTOR_NUM_IN_LEVEL[2]);
-        ASSERT(table[i].Allocate(freeMap, allocateSectors));
+        int allocateSectors = min(remainSector, SECTOR_NUM_PER_POINTER[LEVEL_3]);
+        if (table[i] != nullptr) delete table[i];
+        table[i] = new DoubleIndirectPointer();
+        ASSERT(table[i]->Allocate(freeMap, allocateSectors));
         remainSector -= allocateSectors;
     }
     ASSERT(remainSector == 0);
@@ -264,11 +240,17 @@ bool TripleIndirectPointer::Allocate(PersistentBitmap *freeMap, int numSectors)
 
 void TripleIndirectPointer::Deallocate(PersistentBitmap *freeMap) {
     for (int i = 0; i < numPointer; i++) {
-        table[i].Deallocate(freeMap);
+        table[i]->Deallocate(freeMap);
+        delete table[i];
+        table[i] = nullptr;
+
+        ASSERT(freeMap->Test((int)pointerSectors[i]));  // ought to be marked!
+        freeMap->Clear((int)pointerSectors[i]);
     }
 }
 
 void TripleIndirectPointer::FetchFrom(int sectorNumber) {
+    DiskLayerScope scope(LayerHeader);
     int cacheArraySize = SectorSize / sizeof(int);
     int cache[cacheArraySize];
     memset(cache, -1, sizeof(cache));
@@ -279,11 +261,14 @@ void TripleIndirectPointer::FetchFrom(int sectorNumber) {
     }
     for(int i = 0; i < numPointer; i++) {
         ASSERT(pointerSectors[i] >= 0);
-        table[i].FetchFrom(pointerSectors[i]);
+        if (table[i] != nullptr) delete table[i];
+        table[i] = new DoubleIndirectPointer();
+        table[i]->FetchFrom(pointerSectors[i]);
     }
 }
 
 void TripleIndirectPointer::WriteBack(int sectorNumber) {
+    DiskLayerScope scope(LayerHeader);
     int cacheArraySize = SectorSize / sizeof(int);
     int cache[cacheArraySize];
     memset(cache, -1, sizeof(cache));
@@ -293,17 +278,33 @@ void TripleIndirectPointer::WriteBack(int sectorNumber) {
     }
     for(int i = 0; i < numPointer; i++) {
         ASSERT(pointerSectors[i] >= 0);
-        table[i].WriteBack(pointerSectors[i]);
+        table[i]->WriteBack(pointerSectors[i]);
     }
     kernel->synchDisk->WriteSector(sectorNumber, (char *)cache);
 }
 
 int TripleIndirectPointer::ByteToSector(int offset) {
-    int pointerIndex = divRoundDown(offset, SIZE_IN_LEVEL[2]);
-    int newOffset = offset % SIZE_IN_LEVEL[2];
-    ASSERT(pointerIndex < NUM_INDIRECT_POINTER);
+    int pointerIndex = divRoundDown(offset, SIZE_PER_POINTER[LEVEL_3]);
+    int newOffset = offset % SIZE_PER_POINTER[LEVEL_3];
+    ASSERT(pointerIndex < numPointer);
     ASSERT(pointerSectors[pointerIndex] >= 0);
-    return table[pointerIndex].ByteToSector(newOffset);
+    return table[pointerIndex]->ByteToSector(newOffset);
+}
+
+//----------------------------------------------------------------------
+// FileHeader::FileHeader
+// 	Make an empty header, with no pointers allocated yet.
+//----------------------------------------------------------------------
+
+FileHeader::FileHeader() {
+    numBytes = 0;
+    numPointer = 0;
+    level = LEVEL_INLINE;
+    for (int i = 0; i < NUM_FILE_HEADER_POINTER; i++) {
+        pointerSectors[i] = -1;
+        table[i] = nullptr;
+    }
+    memset(inlineData, 0, sizeof(inlineData));
 }
 
 //----------------------------------------------------------------------
@@ -327,6 +328,8 @@ FileHeader::~FileHeader() {
 //	Return FALSE if there are not enough free blocks to accomodate
 //	the new file.
 //
+//	Small files are kept inline, and need no data blocks at all.
+//
 //	"freeMap" is the bit map of free disk sectors
 //	"fileSize" is the bit map of free disk sectors
 //----------------------------------------------------------------------
@@ -335,6 +338,13 @@ bool FileHeader::Allocate(PersistentBitmap *freeMap, int fileSize) {
     numBytes = fileSize;
     int numSectors = divRoundUp(fileSize, SectorSize);
 
+    if (fileSize <= (int)INLINE_DATA_SIZE) {
+        level = LEVEL_INLINE;
+        numPointer = 0;
+        memset(inlineData, 0, sizeof(inlineData));
+        return true;
+    }
+
     if (fileSize <= LEVEL_1_SIZE)
         level = LEVEL_1;
     else if (fileSize <= LEVEL_2_SIZE)
@@ -346,7 +356,7 @@ bool FileHeader::Allocate(PersistentBitmap *freeMap, int fileSize) {
     else
         return false;  // even the maximum level can't have capacity to store all the data
 
-    numPointer = divRoundUp(numSectors, SECTOR_NUM_IN_LEVEL[level - 1]);
+    numPointer = divRoundUp(numSectors, SECTOR_NUM_PER_POINTER[level]);
     ASSERT(numPointer <= NUM_FILE_HEADER_POINTER);
     if (freeMap->NumClear() < numPointer) {
         return false;  // not enough space for pointer
@@ -357,6 +367,9 @@ bool FileHeader::Allocate(PersistentBitmap *freeMap, int fileSize) {
         // we expect this to succeed
         ASSERT(pointerSectors[i] >= 0);
     }
+    if (level == LEVEL_1) {
+        return true;  // the pointers are the data sectors themselves
+    }
 
     int remainSector = numSectors;
     for (int i = 0; i < numPointer; i++) {
@@ -365,7 +378,7 @@ bool FileHeader::Allocate(PersistentBitmap *freeMap, int fileSize) {
         ASSERT(table[i] != nullptr);
         // let each pointer to allocate their space
         ASSERT(remainSector > 0);
-        int allocateSectors = min(remainSector, SECTOR_NUM_IN_LEVEL[level - 1]);
+        int allocateSectors = min(remainSector, SECTOR_NUM_PER_POINTER[level]);
         ASSERT(table[i]->Allocate(freeMap, allocateSectors));
         remainSector -= allocateSectors;
     }
@@ -381,15 +394,14 @@ bool FileHeader::Allocate(PersistentBitmap *freeMap, int fileSize) {
 //----------------------------------------------------------------------
 
 void FileHeader::Deallocate(PersistentBitmap *freeMap) {
-    for (int i = 0; i < NUM_FILE_HEADER_POINTER; i++) {
+    for (int i = 0; i < numPointer; i++) {
         if (table[i] != nullptr) {
             table[i]->Deallocate(freeMap);
             delete table[i];
             table[i] = nullptr;
-
-            ASSERT(freeMap->Test((int)pointerSectors[i]));  // ought to be marked!
-            freeMap->Clear((int)pointerSectors[i]);
         }
+        ASSERT(freeMap->Test((int)pointerSectors[i]));  // ought to be marked!
+        freeMap->Clear((int)pointerSectors[i]);
     }
 }
 
@@ -401,12 +413,28 @@ void FileHeader::Deallocate(PersistentBitmap *freeMap) {
 //----------------------------------------------------------------------
 
 void FileHeader::FetchFrom(int sector) {
+    DiskLayerScope scope(LayerHeader);
     int cacheArraySize = SectorSize / sizeof(int);
     int cache[cacheArraySize];
     memset(cache, -1, sizeof(cache));
     kernel->synchDisk->ReadSector(sector, (char *)cache);
     numBytes = cache[0];
     numPointer = cache[1];
+
+    for (int i = 0; i < NUM_FILE_HEADER_POINTER; i++) {  // forget any header fetched before
+        if (table[i] != nullptr) {
+            delete table[i];
+            table[i] = nullptr;
+        }
+    }
+
+    if (numBytes <= (int)INLINE_DATA_SIZE) {
+        level = LEVEL_INLINE;
+        ASSERT(numPointer == 0);
+        bcopy((char *)&cache[2], inlineData, INLINE_DATA_SIZE);
+        return;
+    }
+
     for (int i = 0; i < NUM_FILE_HEADER_POINTER; i++) {
         pointerSectors[i] = cache[2 + i];
     }
@@ -424,8 +452,10 @@ void FileHeader::FetchFrom(int sector) {
         decideLevel = false;  // even the maximum level can't have capacity to store all the data
     ASSERT(decideLevel);
 
+    if (level == LEVEL_1) {
+        return;  // pointerSectors already are the data sectors
+    }
     for (int i = 0; i < numPointer; i++) {
-        if (table[i] != nullptr) delete table[i];
         table[i] = GetNewPointerByLevel(level);
         ASSERT(table[i] != nullptr);
         ASSERT(pointerSectors[i] >= 0);
@@ -441,16 +471,22 @@ void FileHeader::FetchFrom(int sector) {
 //----------------------------------------------------------------------
 
 void FileHeader::WriteBack(int sector) {
+    DiskLayerScope scope(LayerHeader);
     int cacheArraySize = SectorSize / sizeof(int);
     int cache[cacheArraySize];
     memset(cache, -1, sizeof(cache));
     cache[0] = numBytes;
     cache[1] = numPointer;
+    if (level == LEVEL_INLINE) {
+        bcopy(inlineData, (char *)&cache[2], INLINE_DATA_SIZE);
+        kernel->synchDisk->WriteSector(sector, (char *)cache);
+        return;
+    }
     for (int i = 0; i < NUM_FILE_HEADER_POINTER; i++) {
         cache[2 + i] = pointerSectors[i];
     }
 
-    for (int i = 0; i < numPointer; i++) {
+    for (int i = 0; i < numPointer && level != LEVEL_1; i++) {
         ASSERT(pointerSectors[i] >= 0);
         ASSERT(table[i] != nullptr);
         table[i]->WriteBack(pointerSectors[i]);
@@ -469,9 +505,13 @@ void FileHeader::WriteBack(int sector) {
 //----------------------------------------------------------------------
 
 int FileHeader::ByteToSector(int offset) {
-    int pointerIndex = divRoundDown(offset, SIZE_IN_LEVEL[level - 1]);
-    int newOffset = offset % SIZE_IN_LEVEL[level - 1];
-    ASSERT(pointerIndex < NUM_FILE_HEADER_POINTER);
+    ASSERT(level != LEVEL_INLINE);  // inline data has no sector of its own
+    int pointerIndex = divRoundDown(offset, SIZE_PER_POINTER[level]);
+    int newOffset = offset % SIZE_PER_POINTER[level];
+    ASSERT(pointerIndex < numPointer);
+    if (level == LEVEL_1) {
+        return pointerSectors[pointerIndex];
+    }
     ASSERT(table[pointerIndex] != nullptr);
     return table[pointerIndex]->ByteToSector(newOffset);
 }
@@ -495,6 +535,18 @@ void FileHeader::Print() {
     int i, j, k;
     // char *data = new char[SectorSize];
 
+    if (level == LEVEL_INLINE) {
+        printf("FileHeader contents.  File size: %d.  Inline data:\n", numBytes);
+        for (j = 0; j < numBytes; j++) {
+            if ('\040' <= inlineData[j] && inlineData[j] <= '\176') {
+                printf("%c", inlineData[j]);
+            } else {
+                printf("\\%x", (unsigned char)inlineData[j]);
+            }
+        }
+        printf("\n");
+        return;
+    }
     printf("FileHeader contents.  File size: %d.  File blocks:\n", numBytes);
     for (i = k = 0; i < numPointer; i++) {
         // printf("\nFile contents in Sector %d:\n", dataSectors[i]);
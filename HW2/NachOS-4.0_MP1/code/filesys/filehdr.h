@@ -21,23 +21,44 @@
 #define NUM_FILE_HEADER_POINTER (NUM_INT_IN_SECTOR - 2)
 #define NUM_INDIRECT_POINTER (NUM_INT_IN_SECTOR - 1)
 
-#define LEVEL_1_SECTOR_NUM NUM_FILE_HEADER_POINTER
-#define LEVEL_2_SECTOR_NUM NUM_FILE_HEADER_POINTER *NUM_INDIRECT_POINTER
-#define LEVEL_3_SECTOR_NUM NUM_FILE_HEADER_POINTER *NUM_INDIRECT_POINTER *NUM_INDIRECT_POINTER
-#define LEVEL_4_SECTOR_NUM NUM_FILE_HEADER_POINTER *NUM_INDIRECT_POINTER *NUM_INDIRECT_POINTER *NUM_INDIRECT_POINTER
-
-#define LEVEL_1_SIZE SectorSize *LEVEL_1_SECTOR_NUM  // 128bytes * 30 = 3840bytes
-#define LEVEL_2_SIZE SectorSize *LEVEL_2_SECTOR_NUM  // 128bytes * 30 * 31 = 119040bytes(116kB)
-#define LEVEL_3_SIZE SectorSize *LEVEL_3_SECTOR_NUM  // 128bytes * 30 * 31 * 31 = 3690240bytes(3.5mB)
-#define LEVEL_4_SIZE SectorSize *LEVEL_4_SECTOR_NUM  // 128bytes * 30 * 31 * 31 * 31 = 114,397,440bytes(109mB)
-
+// A level never needs to address more sectors than the disk has, so the
+// counts are capped at NumSectors; with big sectors (-DSECTOR_SIZE=4096)
+// the uncapped products would not even fit in an int.
+#define CAP_TO_DISK(n) ((n) > (long long)NumSectors ? NumSectors : (int)(n))
+
+#define LEVEL_1_SECTOR_NUM CAP_TO_DISK((long long)NUM_FILE_HEADER_POINTER)
+#define LEVEL_2_SECTOR_NUM CAP_TO_DISK((long long)NUM_FILE_HEADER_POINTER * NUM_INDIRECT_POINTER)
+#define LEVEL_3_SECTOR_NUM CAP_TO_DISK((long long)NUM_FILE_HEADER_POINTER * NUM_INDIRECT_POINTER * NUM_INDIRECT_POINTER)
+#define LEVEL_4_SECTOR_NUM CAP_TO_DISK((long long)NUM_FILE_HEADER_POINTER * NUM_INDIRECT_POINTER * NUM_INDIRECT_POINTER * NUM_INDIRECT_POINTER)
+
+// With the default 128 bytes sectors (the capacity scales with SECTOR_SIZE):
+#define LEVEL_1_SIZE (SectorSize * LEVEL_1_SECTOR_NUM)  // 128bytes * 30 = 3840bytes
+#define LEVEL_2_SIZE (SectorSize * LEVEL_2_SECTOR_NUM)  // 128bytes * 30 * 31 = 119040bytes(116kB)
+#define LEVEL_3_SIZE (SectorSize * LEVEL_3_SECTOR_NUM)  // 128bytes * 30 * 31 * 31 = 3690240bytes(3.5mB)
+#define LEVEL_4_SIZE (SectorSize * LEVEL_4_SECTOR_NUM)  // 128bytes * 30 * 31 * 31 * 31 = 114,397,440bytes(109mB)
+
+// Files no bigger than this keep their data inside the header sector
+// itself, right behind numBytes and numPointer, and use no pointers at all.
+#define INLINE_DATA_SIZE (SectorSize - 2 * sizeof(int))  // 128bytes - 8 = 120bytes
+
+#define LEVEL_INLINE 0
 #define LEVEL_1 1
 #define LEVEL_2 2
 #define LEVEL_3 3
 #define LEVEL_4 4
 
-const int SECTOR_NUM_IN_LEVEL[5] = {1, LEVEL_1_SECTOR_NUM, LEVEL_2_SECTOR_NUM, LEVEL_3_SECTOR_NUM, LEVEL_4_SECTOR_NUM};
-const int SIZE_IN_LEVEL[5] = {SectorSize, LEVEL_1_SIZE, LEVEL_2_SIZE, LEVEL_3_SIZE, LEVEL_4_SIZE};
+// How many data sectors (and bytes) a single file header pointer reaches
+// in a file of each level: a data sector, a single indirect block, ...
+const int SECTOR_NUM_PER_POINTER[5] = {
+    0, 1,
+    CAP_TO_DISK((long long)NUM_INDIRECT_POINTER),
+    CAP_TO_DISK((long long)NUM_INDIRECT_POINTER * NUM_INDIRECT_POINTER),
+    CAP_TO_DISK((long long)NUM_INDIRECT_POINTER * NUM_INDIRECT_POINTER * NUM_INDIRECT_POINTER)};
+const int SIZE_PER_POINTER[5] = {
+    0, SectorSize,
+    SectorSize * SECTOR_NUM_PER_POINTER[2],
+    SectorSize * SECTOR_NUM_PER_POINTER[3],
+    SectorSize * SECTOR_NUM_PER_POINTER[4]};
 
 // The following class defines the Nachos "file header" (in UNIX terms,
 // the "i-node"), describing where on disk to find all of the data in the file.
@@ -50,9 +71,13 @@ const int SIZE_IN_LEVEL[5] = {SectorSize, LEVEL_1_SIZE, LEVEL_2_SIZE, LEVEL_3_SI
 // as one disk sector.  Without indirect addressing, this
 // limits the maximum file length to just under 4K bytes.
 //
-// There is no constructor; rather the file header can be initialized
-// by allocating blocks for the file (if it is a new file), or by
-// reading it from disk.
+// Small files (up to INLINE_DATA_SIZE bytes) store their data in the
+// header sector instead of pointers, so reading the header is all the
+// disk I/O they need.
+//
+// The constructor only makes an empty header; the file header is
+// initialized by allocating blocks for the file (if it is a new file),
+// or by reading it from disk.
 
 class DataPointerInterface {
    public:
@@ -66,18 +91,9 @@ class DataPointerInterface {
 
 DataPointerInterface* GetNewPointerByLevel(int level);
 
-class DirectPointer : public DataPointerInterface {
-   public:
-    ~DirectPointer() override;
-    bool Allocate(PersistentBitmap *bitMap, int numSectors) override;
-    void Deallocate(PersistentBitmap *bitMap) override;
-    void FetchFrom(int sectorNumber) override;
-    void WriteBack(int sectorNumber) override;
-    int ByteToSector(int offset) override;
-
-   private:
-    int dataSector;
-};
+// A LEVEL_1 file needs no pointer objects: its header pointers are
+// the data sectors.  The classes below sit behind each header pointer
+// of a LEVEL_2, LEVEL_3 or LEVEL_4 file.
 
 class SingleIndirectPointer : public DataPointerInterface {
    public:
@@ -90,12 +106,12 @@ class SingleIndirectPointer : public DataPointerInterface {
 
    private:
     int numPointer;  // Number of pointer in the file
-    int pointerSectors[NUM_INDIRECT_POINTER];
-    // DirectPointer table[NUM_INDIRECT_POINTER];
+    int pointerSectors[NUM_INDIRECT_POINTER];  // the data sectors
 };
 
 class DoubleIndirectPointer : public DataPointerInterface {
    public:
+    DoubleIndirectPointer();
     ~DoubleIndirectPointer() override;
     bool Allocate(PersistentBitmap *bitMap, int numSectors) override;
     void Deallocate(PersistentBitmap *bitMap) override;
@@ -106,11 +122,12 @@ class DoubleIndirectPointer : public DataPointerInterface {
    private:
     int numPointer;  // Number of pointer in the file
     int pointerSectors[NUM_INDIRECT_POINTER];
-    SingleIndirectPointer table[NUM_INDIRECT_POINTER];
+    SingleIndirectPointer *table[NUM_INDIRECT_POINTER];  // only the used ones are allocated
 };
 
 class TripleIndirectPointer : public DataPointerInterface {
    public:
+    TripleIndirectPointer();
     ~TripleIndirectPointer() override;
     bool Allocate(PersistentBitmap *bitMap, int numSectors) override;
     void Deallocate(PersistentBitmap *bitMap) override;
@@ -121,11 +138,12 @@ class TripleIndirectPointer : public DataPointerInterface {
    private:
     int numPointer;  // Number of pointer in the file
     int pointerSectors[NUM_INDIRECT_POINTER];
-    DoubleIndirectPointer table[NUM_INDIRECT_POINTER];
+    DoubleIndirectPointer *table[NUM_INDIRECT_POINTER];  // only the used ones are allocated
 };
 
 class FileHeader {
    public:
+    FileHeader();   // Constructor, an empty header
     ~FileHeader();  // Destructor
 
     bool Allocate(PersistentBitmap *bitMap, int fileSize);  // Initialize a file header,
@@ -146,6 +164,11 @@ class FileHeader {
     int FileLength();  // Return the length of the file
                        // in bytes
 
+    bool IsInline() { return level == LEVEL_INLINE; }  // Data kept in the header?
+    char *InlineData() { return inlineData; }          // Data of an inline file;
+                                                       // write the header back
+                                                       // after changing it
+
     void Print();  // Print the contents of the file.
 
    private:
@@ -153,7 +176,10 @@ class FileHeader {
     int numPointer;  // Number of pointer in the file
     int pointerSectors[NUM_FILE_HEADER_POINTER];
     int level;                                             // represent the header level, not necessary to write back to disk
-    DataPointerInterface *table[NUM_FILE_HEADER_POINTER];  // it may have direct, singleIndirect...
+    DataPointerInterface *table[NUM_FILE_HEADER_POINTER];  // singleIndirect, doubleIndirect...
+                                                           // (unused for LEVEL_1)
+    char inlineData[INLINE_DATA_SIZE];                     // file data, if the file is inline,
+                                                           // stored in place of pointerSectors
 };
 
 #endif  // FILEHDR_H
@@ -10,13 +10,14 @@
 //	   An entry in the file system directory
 //
 // 	The file system consists of several data structures:
+//	   A superblock summarizing the file system (cf. superblock.h)
 //	   A bitmap of free disk sectors (cf. bitmap.h)
 //	   A directory of file names and file headers
 //
-//      Both the bitmap and the directory are represented as normal
-//	files.  Their file headers are located in specific sectors
-//	(sector 0 and sector 1), so that the file system can find them
-//	on bootup.
+//	The superblock lives in sector 0.  Both the bitmap and the 
+//	directory are represented as normal files.  Their file headers
+//	are located in specific sectors (sector 1 and sector 2), so that 
+//	the file system can find them on bootup.
 //
 //	The file system assumes that the bitmap and directory files are
 //	kept "open" continuously while Nachos is running.
@@ -53,13 +54,19 @@
 #include "directory.h"
 #include "disk.h"
 #include "filehdr.h"
+#include "inode.h"
+#include "main.h"
 #include "pbitmap.h"
+#include "superblock.h"
+#include "swap.h"
+#include "synchdisk.h"
 
-// Sectors containing the file headers for the bitmap of free sectors,
-// and the directory of files.  These file headers are placed in well-known
-// sectors, so that they can be located on boot-up.
-#define FreeMapSector 0
-#define DirectorySector 1
+// Sectors containing the superblock, and the file headers for the bitmap
+// of free sectors and the directory of files.  These are placed in 
+// well-known sectors, so that they can be located on boot-up.
+#define SuperBlockSector 0
+#define FreeMapSector 1
+#define DirectorySector 2
 
 // Initial file sizes for the bitmap and directory; until the file system
 // supports extensible files, the directory size sets the maximum number
@@ -74,14 +81,20 @@
 //	an empty directory, and a bitmap of free sectors (with almost but
 //	not all of the sectors marked as free).
 //
-//	If format = FALSE, we just have to open the files
-//	representing the bitmap and the directory.
+//	If format = FALSE, we just have to read the superblock and open
+//	the files representing the bitmap and the directory.  If the
+//	superblock says the disk wasn't cleanly unmounted, its counters
+//	can't be trusted, so we count them again.
+//
+//	While Nachos runs the superblock is marked "not clean"; the
+//	destructor marks it clean again.
 //
 //	"format" -- should we initialize the disk?
 //----------------------------------------------------------------------
 
 FileSystem::FileSystem(bool format) {
     DEBUG(dbgFile, "Initializing the file system.");
+    superBlock = new SuperBlock;
     if (format) {
         PersistentBitmap *freeMap = new PersistentBitmap(NumSectors);
         Directory *directory = new Directory(NumDirEntries);
@@ -91,11 +104,18 @@ FileSystem::FileSystem(bool format) {
 
         DEBUG(dbgFile, "Formatting the file system.");
 
-        // First, allocate space for FileHeaders for the directory and bitmap
-        // (make sure no one else grabs these!)
+        // First, allocate space for the superblock and the FileHeaders
+        // for the directory and bitmap (make sure no one else grabs these!)
+        freeMap->Mark(SuperBlockSector);
         freeMap->Mark(FreeMapSector);
         freeMap->Mark(DirectorySector);
 
+        // The swap area at the end of the disk belongs to the virtual
+        // memory system, not to any file.
+        for (int i = 0; i < NumSwapSectors; i++) {
+            freeMap->Mark(SwapFirstSector + i);
+        }
+
         // Second, allocate space for the data blocks containing the contents
         // of the directory and bitmap files.  There better be enough space!
         ASSERT(mapHdr->Allocate(freeMap, FreeMapFileSize));
@@ -127,7 +147,13 @@ FileSystem::FileSystem(bool format) {
         freeMap->WriteBack(freeMapFile);  // flush changes to disk
         directory->WriteBack(directoryFile);
 
+        // Last, the superblock: the only file headers in use are the
+        // bitmap's and the root directory's.
+        superBlock->SetFreeSectors(freeMap->NumClear());
+        superBlock->SetNumInodes(2);
+
         if (debug->IsEnabled('f')) {
+            superBlock->Print();
             freeMap->Print();
             directory->Print();
         }
@@ -141,15 +167,40 @@ FileSystem::FileSystem(bool format) {
     } else {
         // if we are not formatting the disk, just open the files representing
         // the bitmap and directory; these are left open while Nachos is running
+        superBlock->FetchFrom(SuperBlockSector);
+        if (!superBlock->IsValid()) {
+            cerr << "The disk was not formatted by this version of the "
+                 << "file system; format it again (-f).\n";
+            Abort();
+        }
         freeMapFile = new OpenFile(FreeMapSector);
         directoryFile = new OpenFile(DirectorySector);
         currentDirectoryFile = new OpenFile(DirectorySector);  // root directory
         currentDirectory = new Directory(NumDirEntries);
         currentDirectory->FetchFrom(currentDirectoryFile);
+
+        if (!superBlock->IsClean()) {
+            DEBUG(dbgFile, "File system was not cleanly unmounted, recounting.");
+            PersistentBitmap *freeMap = new PersistentBitmap(freeMapFile, NumSectors);
+            superBlock->SetFreeSectors(freeMap->NumClear());
+            superBlock->SetNumInodes(2 + currentDirectory->NumFilesRecursive());
+            delete freeMap;
+        }
     }
+    superBlock->SetClean(FALSE);  // until we are unmounted
+    superBlock->WriteBack(SuperBlockSector);
 }
 
+//----------------------------------------------------------------------
+// FileSystem::~FileSystem
+// 	Unmount the file system: mark the superblock clean, and close
+//	the files that were kept open while Nachos was running.
+//----------------------------------------------------------------------
+
 FileSystem::~FileSystem() {
+    superBlock->SetClean(TRUE);
+    superBlock->WriteBack(SuperBlockSector);
+    delete superBlock;
     if (currentDirectoryFile != NULL)
         delete currentDirectoryFile;
     if (currentDirectory != NULL)
@@ -158,6 +209,31 @@ FileSystem::~FileSystem() {
     delete directoryFile;
 }
 
+//----------------------------------------------------------------------
+// FileSystem::FetchFreeMap
+// 	Read the bitmap of free sectors from disk.  The number of free
+//	sectors comes from the superblock, so the map is never scanned
+//	just to count them.
+//----------------------------------------------------------------------
+
+PersistentBitmap *FileSystem::FetchFreeMap() {
+    return new PersistentBitmap(freeMapFile, NumSectors, superBlock->FreeSectors());
+}
+
+//----------------------------------------------------------------------
+// FileSystem::FlushFreeMap
+// 	Write a modified bitmap of free sectors back to disk, together
+//	with the superblock holding its free count.
+//
+//	"freeMap" is the bit map of free disk sectors
+//----------------------------------------------------------------------
+
+void FileSystem::FlushFreeMap(PersistentBitmap *freeMap) {
+    freeMap->WriteBack(freeMapFile);
+    superBlock->SetFreeSectors(freeMap->NumClear());
+    superBlock->WriteBack(SuperBlockSector);
+}
+
 bool FileSystem::ChangeCurrentDirectory(char *name) {
     currentDirectory->FetchFrom(currentDirectoryFile);
     int dirSector = currentDirectory->Find(name);
@@ -226,6 +302,7 @@ void FileSystem::ResetToRootDirectory() {
 }
 
 bool FileSystem::CreateDirectory(char *name) {
+    FsOperationScope profile(FsCreate);
     // std::cout << "Creating directory " << name << " by filesystem" << std::endl;
     PersistentBitmap *freeMap;
     FileHeader *hdr;
@@ -236,7 +313,7 @@ bool FileSystem::CreateDirectory(char *name) {
         success = FALSE;  // dir is already in directory
         // std::cout << "dir \"" << name << "\" is already in directory" << std::endl;
     } else {
-        freeMap = new PersistentBitmap(freeMapFile, NumSectors);
+        freeMap = FetchFreeMap();
         sector = freeMap->FindAndSet();  // find a sector to hold the file header
         if (sector == -1) {
             success = FALSE;  // no free block for file header
@@ -260,7 +337,8 @@ bool FileSystem::CreateDirectory(char *name) {
                 delete newDir;
 
                 currentDirectory->WriteBack(currentDirectoryFile);
-                freeMap->WriteBack(freeMapFile);
+                superBlock->AddInodes(1);
+                FlushFreeMap(freeMap);
             }
             delete hdr;
         }
@@ -299,6 +377,7 @@ bool FileSystem::CreateDirectory(char *name) {
 //----------------------------------------------------------------------
 
 bool FileSystem::Create(char *path, int initialSize) {
+    FsOperationScope profile(FsCreate);
     bool success = false;
     char currentPath[PATH_MAX_LEN];
     char filename[FileNameMaxLen];
@@ -328,7 +407,7 @@ bool FileSystem::CreateFile(char *name, int initialSize) {
         success = FALSE;  // dir is already in directory
         // std::cout << "file \"" << name << "\" is already in directory" << std::endl;
     } else {
-        freeMap = new PersistentBitmap(freeMapFile, NumSectors);
+        freeMap = FetchFreeMap();
         sector = freeMap->FindAndSet();  // find a sector to hold the file header
         if (sector == -1) {
             success = FALSE;  // no free block for file header
@@ -346,7 +425,8 @@ bool FileSystem::CreateFile(char *name, int initialSize) {
                 // everthing worked, flush all changes back to disk
                 hdr->WriteBack(sector);
                 currentDirectory->WriteBack(currentDirectoryFile);
-                freeMap->WriteBack(freeMapFile);
+                superBlock->AddInodes(1);
+                FlushFreeMap(freeMap);
             }
             delete hdr;
         }
@@ -367,6 +447,7 @@ bool FileSystem::CreateFile(char *name, int initialSize) {
 
 OpenFile *
 FileSystem::Open(char *path) {
+    FsOperationScope profile(FsOpen);
     OpenFile *openFile = NULL;
     int sector;
     DEBUG(dbgFile, "Opening file" << path);
@@ -388,51 +469,96 @@ FileSystem::Open(char *path) {
     return openFile;
 }
 
+//----------------------------------------------------------------------
+// FileSystem::OpenAFile
+// 	Open a file on behalf of the running user program, and give it
+//	a descriptor in the program's own descriptor table.  Return the
+//	descriptor, or -1 if the file can't be found or the program has
+//	too many files open.
+//
+//	"path" -- the full path of the file to be opened
+//----------------------------------------------------------------------
+
 OpenFileId
 FileSystem::OpenAFile(char *path) {
-    OpenFile *openFile = NULL;
-    int sector;
-    DEBUG(dbgFile, "Opening file" << path);
-
-    char currentPath[PATH_MAX_LEN];
-    char filename[FileNameMaxLen];
-    memset(currentPath, 0, sizeof(char) * PATH_MAX_LEN);
-    memset(filename, 0, sizeof(char) * FileNameMaxLen);
-    if (ChangeCurrentDirectoryByWholePath(path, currentPath, filename)) {
-        sector = currentDirectory->Find(filename);
-        if (sector >= 0) {
-            openFile = new OpenFile(sector);  // name was found in directory
-            table.insert({sector, openFile});
-            // std::cout << "open file: " << filename << " on dir \"" << currentPath << "\" success!" << std::endl;
-        } else {
-            // std::cout << "open file: " << filename << " on dir \"" << currentPath << "\" fail!" << std::endl;
-        }
+    OpenFile *openFile = Open(path);
+    if (openFile == NULL) {
+        return -1;
     }
-    ResetToRootDirectory();
-    return sector;
+    OpenFileId fd = CurrentFileTable()->Add(openFile);
+    if (fd == -1) {
+        delete openFile;  // no free descriptor
+    }
+    return fd;
 }
 
+//----------------------------------------------------------------------
+// FileSystem::WriteFile/ReadFile/SeekFile/CloseFile
+// 	Write/read/seek/close a file the running user program opened with
+//	OpenAFile.  WriteFile and ReadFile return the number of bytes
+//	transferred, or -1 if "fd" isn't open; SeekFile returns 1 on
+//	success, -1 if "fd" isn't open or "position" is negative;
+//	CloseFile returns 1 on success, 0 if "fd" isn't open.
+//----------------------------------------------------------------------
+
 int FileSystem::WriteFile(char *buffer, int size, OpenFileId fd) {
-    OpenFile *openFile = table[fd];
+    FsOperationScope profile(FsWrite);
+    OpenFile *openFile = CurrentFileTable()->Get(fd);
     if (!openFile) return -1;
     return openFile->Write(buffer, size);
 }
 
 int FileSystem::ReadFile(char *buffer, int size, OpenFileId fd) {
-    OpenFile *openFile = table[fd];
+    FsOperationScope profile(FsRead);
+    OpenFile *openFile = CurrentFileTable()->Get(fd);
     if (!openFile) return -1;
     return openFile->Read(buffer, size);
 }
 
-int FileSystem::CloseFile(OpenFileId fd) {
-    OpenFile *openFile = table[fd];
-    if (!openFile) return 0;
-    OpenFile *eraseFile = openFile;
-    table.erase(fd);
-    delete eraseFile;
+//----------------------------------------------------------------------
+// FileSystem::PWriteFile/PReadFile
+// 	Write/read a file the running user program opened, at an
+//	explicit "position", without touching its seek position.
+//	Return the number of bytes transferred, or -1 if "fd" isn't
+//	open or "position" is negative.
+//----------------------------------------------------------------------
+
+int FileSystem::PWriteFile(char *buffer, int size, int position, OpenFileId fd) {
+    FsOperationScope profile(FsWrite);
+    OpenFile *openFile = CurrentFileTable()->Get(fd);
+    if (!openFile || position < 0) return -1;
+    return openFile->WriteAt(buffer, size, position);
+}
+
+int FileSystem::PReadFile(char *buffer, int size, int position, OpenFileId fd) {
+    FsOperationScope profile(FsRead);
+    OpenFile *openFile = CurrentFileTable()->Get(fd);
+    if (!openFile || position < 0) return -1;
+    return openFile->ReadAt(buffer, size, position);
+}
+
+int FileSystem::SeekFile(int position, OpenFileId fd) {
+    OpenFile *openFile = CurrentFileTable()->Get(fd);
+    if (!openFile || position < 0) return -1;
+    openFile->Seek(position);
     return 1;
 }
 
+int FileSystem::CloseFile(OpenFileId fd) {
+    return CurrentFileTable()->Close(fd) ? 1 : 0;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::CurrentFileTable
+// 	Return the descriptor table of the user program making the
+//	system call.
+//----------------------------------------------------------------------
+
+FileDescriptorTable *FileSystem::CurrentFileTable() {
+    ASSERT(kernel->currentThread->space != NULL);
+    return kernel->currentThread->space->FileTable();
+}
+
 //----------------------------------------------------------------------
 // FileSystem::Remove
 // 	Delete a file from the file system.  This requires:
@@ -442,15 +568,20 @@ int FileSystem::CloseFile(OpenFileId fd) {
 //	    Write changes to directory, bitmap back to disk
 //
 //	Return TRUE if the file was deleted, FALSE if the file wasn't
-//	in the file system.
+//	in the file system, or is a file some program still has open, or
+//	a directory with such a file somewhere inside it.
+//	(Headers of open files are shared through the inode table, so
+//	pulling the sectors out from under them isn't allowed.)
 //
 //	"name" -- the text name of the file to be removed
 //----------------------------------------------------------------------
 
 bool FileSystem::Remove(char *path) {
+    FsOperationScope profile(FsRemove);
     int sector;
     char currentPath[PATH_MAX_LEN];
     char filename[FileNameMaxLen];
+    bool removed = FALSE;
     memset(currentPath, 0, sizeof(char) * PATH_MAX_LEN);
     memset(filename, 0, sizeof(char) * FileNameMaxLen);
     if (ChangeCurrentDirectoryByWholePath(path, currentPath, filename)) {
@@ -460,25 +591,33 @@ bool FileSystem::Remove(char *path) {
         }
         sector = currentDirectory->Find(filename);
         if (sector == -1) {
-            return FALSE;  // file not found
+            removed = FALSE;  // file not found
+        }
+        else if (currentDirectory->IsDirectory(filename)) {
+            removed = RemoveDir(sector, filename);
         }
-        if (currentDirectory->IsDirectory(filename)) {
-            RemoveDir(sector, filename);
+        else if (kernel->inodeTable->IsOpen(sector)) {
+            removed = FALSE;  // still open
         }
         else {
-            RemoveFile(sector, filename);
+            removed = RemoveFile(sector, filename);
         }
     }
     ResetToRootDirectory();
-    return TRUE;
+    return removed;
 }
 
 bool FileSystem::RemoveDir(int sector, char *dirName) {
-    PersistentBitmap *freeMap = new PersistentBitmap(freeMapFile, NumSectors);
     OpenFile *removeDirFile = new OpenFile(sector);
     Directory *removeDir = new Directory(NumDirEntries);
     removeDir->FetchFrom(removeDirFile);
-    ASSERT(removeDir->RemoveRecursive(freeMap));
+    if (removeDir->AnyOpenRecursive()) {
+        delete removeDirFile;  // something inside is still open
+        delete removeDir;
+        return FALSE;
+    }
+    PersistentBitmap *freeMap = FetchFreeMap();
+    int numRemoved = removeDir->RemoveRecursive(freeMap);
     removeDir->WriteBack(removeDirFile);
     delete removeDirFile;
     delete removeDir;
@@ -488,10 +627,12 @@ bool FileSystem::RemoveDir(int sector, char *dirName) {
     fileHdr->Deallocate(freeMap);  // remove data blocks
     freeMap->Clear(sector);        // remove header block
     currentDirectory->Remove(dirName);
-    freeMap->WriteBack(freeMapFile);                    // flush to disk
+    superBlock->AddInodes(-(numRemoved + 1));
+    FlushFreeMap(freeMap);                              // flush to disk
     currentDirectory->WriteBack(currentDirectoryFile);  // flush to disk
     delete fileHdr;
     delete freeMap;
+    return TRUE;
 }
 
 bool FileSystem::RemoveFile(int sector, char *fileName) {
@@ -499,14 +640,16 @@ bool FileSystem::RemoveFile(int sector, char *fileName) {
     FileHeader *fileHdr;
     fileHdr = new FileHeader;
     fileHdr->FetchFrom(sector);
-    freeMap = new PersistentBitmap(freeMapFile, NumSectors);
+    freeMap = FetchFreeMap();
     fileHdr->Deallocate(freeMap);  // remove data blocks
     freeMap->Clear(sector);        // remove header block
     ASSERT(currentDirectory->Remove(fileName));
-    freeMap->WriteBack(freeMapFile);                    // flush to disk
+    superBlock->AddInodes(-1);
+    FlushFreeMap(freeMap);                              // flush to disk
     currentDirectory->WriteBack(currentDirectoryFile);  // flush to disk
     delete fileHdr;
     delete freeMap;
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
@@ -515,6 +658,7 @@ bool FileSystem::RemoveFile(int sector, char *fileName) {
 //----------------------------------------------------------------------
 
 void FileSystem::List(char *path) {
+    FsOperationScope profile(FsList);
     char currentPath[PATH_MAX_LEN];
     char filename[FileNameMaxLen];
     memset(currentPath, 0, sizeof(char) * PATH_MAX_LEN);
@@ -536,6 +680,7 @@ void FileSystem::List(char *path) {
 //----------------------------------------------------------------------
 
 void FileSystem::ListRecursive(char *path) {
+    FsOperationScope profile(FsList);
     char currentPath[PATH_MAX_LEN];
     char filename[FileNameMaxLen];
     memset(currentPath, 0, sizeof(char) * PATH_MAX_LEN);
@@ -560,12 +705,15 @@ void FileSystem::ListRecursive(char *path) {
 //	  for each file in the directory,
 //	      the contents of the file header
 //	      the data in the file
+//	  the disk I/O done so far, by operation and layer
 //----------------------------------------------------------------------
 
 void FileSystem::Print() {
     FileHeader *bitHdr = new FileHeader;
     FileHeader *dirHdr = new FileHeader;
-    PersistentBitmap *freeMap = new PersistentBitmap(freeMapFile, NumSectors);
+    PersistentBitmap *freeMap = FetchFreeMap();
+
+    superBlock->Print();
 
     printf("Bit map file header:\n");
     bitHdr->FetchFrom(FreeMapSector);
@@ -580,6 +728,8 @@ void FileSystem::Print() {
     currentDirectory->FetchFrom(directoryFile);
     currentDirectory->Print();
 
+    kernel->synchDisk->PrintProfile();
+
     delete bitHdr;
     delete dirHdr;
     delete freeMap;
@@ -33,11 +33,12 @@
 #ifndef FS_H
 #define FS_H
 
-#include <map>
-
 #include "copyright.h"
 #include "directory.h"
+#include "fdtable.h"
 #include "openfile.h"
+#include "pbitmap.h"
+#include "superblock.h"
 #include "sysdep.h"
 
 typedef int OpenFileId;
@@ -110,6 +111,38 @@ class FileSystem {
         return -1;
     }
 
+    int PReadFile(char *buffer, int size, int position, OpenFileId fd) {
+        for (int i = 0; i < FS_OPENFILE_NUMS; i++) {
+            if (!fileDescriptorTable[i]) continue;
+            if (fileDescriptorTable[i]->GetFileDescriptor() == fd) {
+                return fileDescriptorTable[i]->ReadAt(buffer, size, position);
+            }
+        }
+        return -1;
+    }
+
+    int PWriteFile(char *buffer, int size, int position, OpenFileId fd) {
+        for (int i = 0; i < FS_OPENFILE_NUMS; i++) {
+            if (!fileDescriptorTable[i]) continue;
+            if (fileDescriptorTable[i]->GetFileDescriptor() == fd) {
+                return fileDescriptorTable[i]->WriteAt(buffer, size, position);
+            }
+        }
+        return -1;
+    }
+
+    int SeekFile(int position, OpenFileId fd) {
+        if (position < 0) return -1;
+        for (int i = 0; i < FS_OPENFILE_NUMS; i++) {
+            if (!fileDescriptorTable[i]) continue;
+            if (fileDescriptorTable[i]->GetFileDescriptor() == fd) {
+                fileDescriptorTable[i]->Seek(position);
+                return 1;
+            }
+        }
+        return -1;
+    }
+
     // Linear search找到對應的OpenFile來Close -> 後續可用HashTable等辦法來優化
     int CloseFile(OpenFileId fd) {
         for (int i = 0; i < FS_OPENFILE_NUMS; i++) {
@@ -158,12 +191,20 @@ class FileSystem {
 
     OpenFile *Open(char *name);  // Open a file (UNIX open)
 
-    OpenFileId OpenAFile(char *filename);
+    OpenFileId OpenAFile(char *filename);  // Open a file for the current
+                                           // user program, return its fd
 
     int WriteFile(char *buffer, int size, OpenFileId fd);
 
     int ReadFile(char *buffer, int size, OpenFileId fd);
 
+    int PWriteFile(char *buffer, int size, int position, OpenFileId fd);
+                                    // Write/read at "position", leaving
+    int PReadFile(char *buffer, int size, int position, OpenFileId fd);
+                                    // the seek position alone (UNIX pwrite/pread)
+
+    int SeekFile(int position, OpenFileId fd);
+
     int CloseFile(OpenFileId fd);
 
     bool Remove(char *name);  // Delete a file (UNIX unlink)
@@ -178,7 +219,17 @@ class FileSystem {
 
     void Print();  // List all the files and their contents
 
+    int FreeSectors() { return superBlock->FreeSectors(); }  // statfs-style summary,
+    int NumInodes() { return superBlock->NumInodes(); }      // kept in the superblock
+
    private:
+    PersistentBitmap *FetchFreeMap();              // Read the free map, with its
+                                                   // free count from the superblock
+    void FlushFreeMap(PersistentBitmap *freeMap);  // Write the free map and the
+                                                   // superblock back to disk
+
+    SuperBlock *superBlock;  // Summary of the file system, read
+                             // once at mount time
     OpenFile *freeMapFile;  // Bit map of free disk blocks,
                             // represented as a file
     OpenFile *directoryFile;  // "Root" directory -- list of
@@ -188,7 +239,8 @@ class FileSystem {
 
     Directory *currentDirectory;
 
-    std::map<OpenFileId, OpenFile *> table;
+    FileDescriptorTable *CurrentFileTable();  // Descriptors of the running
+                                              // user program
 };
 
 #endif  // FILESYS
@@ -0,0 +1,155 @@
+// inode.cc
+//	Routines to manage the in-core inode table, which shares the
+//	file header of an open file between every OpenFile on it.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "inode.h"
+
+#include "copyright.h"
+#include "debug.h"
+
+//----------------------------------------------------------------------
+// InodeKey, InodeHash
+// 	Key and hash functions for the inode hash table.  Headers live
+//	in distinct sectors, so the sector number itself is a fine hash.
+//----------------------------------------------------------------------
+
+static int InodeKey(Inode *inode) { return inode->Sector(); }
+
+static unsigned InodeHash(int sector) { return (unsigned)sector; }
+
+//----------------------------------------------------------------------
+// Inode::Inode
+// 	Bring the file header at "sector" into memory.
+//
+//	"sector" -- the location on disk of the file header
+//----------------------------------------------------------------------
+
+Inode::Inode(int sector) {
+    this->sector = sector;
+    hdr = new FileHeader;
+    hdr->FetchFrom(sector);
+    refCount = 0;
+    blockMap = NULL;
+    numBlocks = 0;
+}
+
+//----------------------------------------------------------------------
+// Inode::~Inode
+// 	De-allocate the in-memory header and sector map.
+//----------------------------------------------------------------------
+
+Inode::~Inode() {
+    ASSERT(refCount == 0);
+    delete hdr;
+    if (blockMap != NULL) {
+        delete[] blockMap;
+    }
+}
+
+//----------------------------------------------------------------------
+// Inode::BlockMap
+// 	Return the disk sector of each sector of the file, flattening
+//	the header's pointer blocks the first time we are asked.  Files
+//	have a fixed size, so the map never goes stale.
+//----------------------------------------------------------------------
+
+int *Inode::BlockMap() {
+    if (blockMap == NULL) {
+        ASSERT(!hdr->IsInline());
+        numBlocks = divRoundUp(hdr->FileLength(), SectorSize);
+        blockMap = new int[numBlocks];
+        for (int i = 0; i < numBlocks; i++) {
+            blockMap[i] = hdr->ByteToSector(i * SectorSize);
+        }
+    }
+    return blockMap;
+}
+
+//----------------------------------------------------------------------
+// Inode::NumBlocks
+// 	Return the number of entries in the sector map.
+//----------------------------------------------------------------------
+
+int Inode::NumBlocks() {
+    BlockMap();
+    return numBlocks;
+}
+
+//----------------------------------------------------------------------
+// InodeTable::InodeTable
+// 	Initialize an empty inode table.
+//----------------------------------------------------------------------
+
+InodeTable::InodeTable() {
+    table = new HashTable<int, Inode *>(InodeKey, InodeHash);
+}
+
+//----------------------------------------------------------------------
+// InodeTable::~InodeTable
+// 	De-allocate the inode table, and the inodes still held by files
+//	that a thread blocked at the halt never closed.  Nothing runs
+//	after the halt to close them.
+//----------------------------------------------------------------------
+
+InodeTable::~InodeTable() {
+    while (!table->IsEmpty()) {
+        HashIterator<int, Inode *> iter(table);
+        Inode *inode = iter.Item();
+
+        table->Remove(inode->sector);
+        inode->refCount = 0;
+        delete inode;
+    }
+    delete table;
+}
+
+//----------------------------------------------------------------------
+// InodeTable::Get
+// 	Return the inode for the file header at "sector", with one more
+//	reference.  If the file isn't open yet, fetch its header from
+//	disk; otherwise share the copy already in memory.
+//
+//	"sector" -- the location on disk of the file header
+//----------------------------------------------------------------------
+
+Inode *InodeTable::Get(int sector) {
+    Inode *inode;
+
+    if (!table->Find(sector, &inode)) {
+        DEBUG(dbgFile, "Fetching inode at sector " << sector);
+        inode = new Inode(sector);
+        table->Insert(inode);
+    }
+    inode->refCount++;
+    return inode;
+}
+
+//----------------------------------------------------------------------
+// InodeTable::Put
+// 	Drop one reference to "inode".  When nobody is using it any
+//	more, take it out of the table and de-allocate it.
+//
+//	"inode" -- an inode returned by Get
+//----------------------------------------------------------------------
+
+void InodeTable::Put(Inode *inode) {
+    ASSERT(inode->refCount > 0);
+    if (--inode->refCount == 0) {
+        DEBUG(dbgFile, "Releasing inode at sector " << inode->sector);
+        table->Remove(inode->sector);
+        delete inode;
+    }
+}
+
+//----------------------------------------------------------------------
+// InodeTable::IsOpen
+// 	Return TRUE if some OpenFile is using the file header at "sector".
+//----------------------------------------------------------------------
+
+bool InodeTable::IsOpen(int sector) {
+    return table->IsInTable(sector);
+}
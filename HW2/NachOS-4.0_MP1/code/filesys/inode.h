@@ -0,0 +1,72 @@
+// inode.h
+//	Data structures for the in-core inode table.
+//
+//	Every open file needs its file header in memory, and for a large
+//	file that means the whole tree of indirect pointer blocks.  Rather
+//	than have each OpenFile fetch its own copy, the header of a file
+//	that is open is kept once, in an Inode, and shared by every
+//	OpenFile on it.  The Inode also holds the flattened sector map
+//	that OpenFile uses to translate offsets to disk sectors.
+//
+//	Inodes are kept in a hash table keyed by the sector of the file
+//	header, and reference counted: opening a file that is already
+//	open just bumps the count, and the Inode is freed when the last
+//	OpenFile on it is closed.  Memory therefore grows with the number
+//	of distinct files open, not with the number of opens.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef INODE_H
+#define INODE_H
+
+#include "copyright.h"
+#include "filehdr.h"
+#include "hash.h"
+
+// The in-core copy of one open file's header.
+
+class Inode {
+   public:
+    Inode(int sector);  // Fetch the header at "sector" from disk
+    ~Inode();           // De-allocate the header and the sector map
+
+    int Sector() { return sector; }
+    FileHeader *Header() { return hdr; }
+
+    int *BlockMap();    // Disk sector of each sector of the file,
+                        // built on first use
+    int NumBlocks();    // Number of entries in BlockMap()
+
+   private:
+    friend class InodeTable;
+
+    int sector;     // Sector holding the file header
+    FileHeader *hdr;  // The header, with all its pointer blocks
+    int refCount;   // Number of OpenFiles using this inode
+    int *blockMap;  // Flattened sector map, NULL until needed
+    int numBlocks;  // Number of entries in blockMap
+};
+
+// The following class defines the table of inodes for the files that
+// are currently open.  There is one, shared by the whole kernel.
+
+class InodeTable {
+   public:
+    InodeTable();   // Initialize an empty table
+    ~InodeTable();  // De-allocate the table
+
+    Inode *Get(int sector);  // Return the inode for the header at
+                             // "sector", fetching it if it isn't
+                             // already in memory
+    void Put(Inode *inode);  // Drop a reference to "inode", freeing
+                             // it if it was the last one
+    bool IsOpen(int sector);  // Is the file whose header is at
+                              // "sector" open?
+
+   private:
+    HashTable<int, Inode *> *table;  // Open inodes, by header sector
+};
+
+#endif  // INODE_H
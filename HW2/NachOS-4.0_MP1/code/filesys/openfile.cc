@@ -5,7 +5,13 @@
 //	the OpenFile data structure).
 //
 //	Also as in UNIX, for convenience, we keep the file header in
-//	memory while the file is open.
+//	memory while the file is open.  The header lives in the kernel's
+//	inode table, so opening a file that is already open shares the
+//	copy in memory instead of reading it again; each OpenFile only
+//	has its own seek position.  Walking the header's pointer
+//	blocks for every sector we touch would be slow, so the inode
+//	flattens them into an array with one disk sector number per
+//	sector of the file.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -15,32 +21,33 @@
 #include "copyright.h"
 #include "main.h"
 #include "filehdr.h"
+#include "inode.h"
 #include "openfile.h"
 #include "synchdisk.h"
 
 //----------------------------------------------------------------------
 // OpenFile::OpenFile
 // 	Open a Nachos file for reading and writing.  Bring the file header
-//	into memory while the file is open.
+//	into memory while the file is open, unless it is open already.
 //
 //	"sector" -- the location on disk of the file header for this file
 //----------------------------------------------------------------------
 
 OpenFile::OpenFile(int sector)
 { 
-    hdr = new FileHeader;
-    hdr->FetchFrom(sector);
+    inode = kernel->inodeTable->Get(sector);
+    hdr = inode->Header();
     seekPosition = 0;
 }
 
 //----------------------------------------------------------------------
 // OpenFile::~OpenFile
-// 	Close a Nachos file, de-allocating any in-memory data structures.
+// 	Close a Nachos file, releasing our reference to its inode.
 //----------------------------------------------------------------------
 
 OpenFile::~OpenFile()
 {
-    delete hdr;
+    kernel->inodeTable->Put(inode);
 }
 
 //----------------------------------------------------------------------
@@ -98,13 +105,20 @@ OpenFile::Write(char *into, int numBytes)
 //
 //	For ReadAt:
 //	   We read in all of the full or partial sectors that are part of the
-//	   request, but we only copy the part we are interested in.
+//	   request, with one disk request for each run of whole sectors
+//	   that are consecutive on disk.  Those go straight into the
+//	   caller's buffer; of a partial one, we only copy the part we
+//	   are interested in.
 //	For WriteAt:
 //	   We must first read in any sectors that will be partially written,
 //	   so that we don't overwrite the unmodified portion.  We then copy
 //	   in the data that will be modified, and write back all the full
 //	   or partial sectors that are part of the request.
 //
+//	The data of an inline file lives in the header, which is already
+//	in memory: reads need no disk I/O at all, and writes only have to
+//	write the header sector back.
+//
 //	"into" -- the buffer to contain the data to be read from disk 
 //	"from" -- the buffer containing the data to be written to disk 
 //	"numBytes" -- the number of bytes to transfer
@@ -116,8 +130,9 @@ int
 OpenFile::ReadAt(char *into, int numBytes, int position)
 {
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
-    char *buf;
+    int i, j, k, s, firstSector, lastSector, numSectors, numRuns, start, end;
+    char sectorBuf[SectorSize];
+    DiskRun *runs;
 
     if ((numBytes <= 0) || (position >= fileLength))
     	return 0; 				// check request
@@ -125,19 +140,39 @@ OpenFile::ReadAt(char *into, int numBytes, int position)
 	numBytes = fileLength - position;
     DEBUG(dbgFile, "Reading " << numBytes << " bytes at " << position << " from file of length " << fileLength);
 
+    if (hdr->IsInline()) {
+        bcopy(&hdr->InlineData()[position], into, numBytes);
+        return numBytes;
+    }
+
     firstSector = divRoundDown(position, SectorSize);
     lastSector = divRoundDown(position + numBytes - 1, SectorSize);
     numSectors = 1 + lastSector - firstSector;
 
-    // read in all the full and partial sectors that we need
-    buf = new char[numSectors * SectorSize];
-    for (i = firstSector; i <= lastSector; i++)	
-        kernel->synchDisk->ReadSector(hdr->ByteToSector(i * SectorSize), 
-					&buf[(i - firstSector) * SectorSize]);
-
-    // copy the part we want
-    bcopy(&buf[position - (firstSector * SectorSize)], into, numBytes);
-    delete [] buf;
+    // read in all the full and partial sectors that we need, a run
+    // of consecutive disk sectors at a time
+    runs = new DiskRun[numSectors];
+    numRuns = MapRange(position, numBytes, runs);
+    // (file sector "s" is the first of run "i")
+    for (i = 0, s = firstSector; i < numRuns; s += runs[i].numSectors, i++)
+	for (j = 0; j < runs[i].numSectors; j = k) {
+	    start = max(position, (s + j) * SectorSize);
+	    end = min(position + numBytes, (s + j + 1) * SectorSize);
+	    if (end - start < SectorSize) {	// only part of it is wanted
+		kernel->synchDisk->ReadSector(runs[i].sector + j, sectorBuf);
+		bcopy(&sectorBuf[start - (s + j) * SectorSize], 
+			&into[start - position], end - start);
+		k = j + 1;
+		continue;
+	    }
+	    // this and the whole sectors after it in the run
+	    for (k = j + 1; k < runs[i].numSectors
+		    && (s + k + 1) * SectorSize <= position + numBytes; k++)
+		;
+	    kernel->synchDisk->ReadSectors(runs[i].sector + j, 
+					&into[start - position], k - j);
+	}
+    delete [] runs;
     return numBytes;
 }
 
@@ -145,9 +180,10 @@ int
 OpenFile::WriteAt(char *from, int numBytes, int position)
 {
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
+    int i, firstSector, lastSector, numSectors, numRuns;
     bool firstAligned, lastAligned;
-    char *buf;
+    char *buf, *sectorBuf;
+    DiskRun *runs;
 
     if ((numBytes <= 0) || (position >= fileLength))
 	return 0;				// check request
@@ -155,6 +191,12 @@ OpenFile::WriteAt(char *from, int numBytes, int position)
 	numBytes = fileLength - position;
     DEBUG(dbgFile, "Writing " << numBytes << " bytes at " << position << " from file of length " << fileLength);
 
+    if (hdr->IsInline()) {
+        bcopy(from, &hdr->InlineData()[position], numBytes);
+        hdr->WriteBack(inode->Sector());
+        return numBytes;
+    }
+
     firstSector = divRoundDown(position, SectorSize);
     lastSector = divRoundDown(position + numBytes - 1, SectorSize);
     numSectors = 1 + lastSector - firstSector;
@@ -174,10 +216,15 @@ OpenFile::WriteAt(char *from, int numBytes, int position)
 // copy in the bytes we want to change 
     bcopy(from, &buf[position - (firstSector * SectorSize)], numBytes);
 
-// write modified sectors back
-    for (i = firstSector; i <= lastSector; i++)	
-        kernel->synchDisk->WriteSector(hdr->ByteToSector(i * SectorSize), 
-					&buf[(i - firstSector) * SectorSize]);
+// write modified sectors back, a disk request per run
+    runs = new DiskRun[numSectors];
+    numRuns = MapRange(position, numBytes, runs);
+    for (i = 0, sectorBuf = buf; i < numRuns; i++) {
+	kernel->synchDisk->WriteSectors(runs[i].sector, sectorBuf, 
+						runs[i].numSectors);
+	sectorBuf += runs[i].numSectors * SectorSize;
+    }
+    delete [] runs;
     delete [] buf;
     return numBytes;
 }
@@ -193,4 +240,68 @@ OpenFile::Length()
     return hdr->FileLength(); 
 }
 
+//----------------------------------------------------------------------
+// OpenFile::Sector
+// 	Return the sector holding the file's header.  Every file has its
+//	own, so it tells two OpenFiles on the same file apart from two on
+//	different files.
+//----------------------------------------------------------------------
+
+int
+OpenFile::Sector()
+{
+    return inode->Sector();
+}
+
+//----------------------------------------------------------------------
+// OpenFile::ByteToSector
+// 	Return which disk sector is storing a particular byte within
+//	the file, like FileHeader::ByteToSector.
+//
+//	"offset" is the location within the file of the byte in question
+//----------------------------------------------------------------------
+
+int
+OpenFile::ByteToSector(int offset)
+{
+    ASSERT(offset >= 0 && offset / SectorSize < inode->NumBlocks());
+    return inode->BlockMap()[offset / SectorSize];
+}
+
+//----------------------------------------------------------------------
+// OpenFile::MapRange
+// 	Translate the sectors covering a byte range of the file into
+//	runs of consecutive disk sectors, in file order.  Since free
+//	sectors are handed out in order, most files map to a handful of
+//	runs.  Return the number of runs.
+//
+//	"offset" -- the offset within the file of the first byte
+//	"numBytes" -- the length of the range, at least one byte
+//	"runs" -- where to put the runs; needs room for one run per
+//		sector in the range, the worst case
+//----------------------------------------------------------------------
+
+int
+OpenFile::MapRange(int offset, int numBytes, DiskRun *runs)
+{
+    int firstSector = divRoundDown(offset, SectorSize);
+    int lastSector = divRoundDown(offset + numBytes - 1, SectorSize);
+    int *blockMap = inode->BlockMap();
+    int numRuns = 0;
+
+    ASSERT(numBytes > 0);
+    ASSERT(firstSector >= 0 && lastSector < inode->NumBlocks());
+    for (int i = firstSector; i <= lastSector; i++) {
+	if (numRuns > 0 && blockMap[i] == 
+		runs[numRuns - 1].sector + runs[numRuns - 1].numSectors) {
+	    runs[numRuns - 1].numSectors++;
+	} else {
+	    runs[numRuns].sector = blockMap[i];
+	    runs[numRuns].numSectors = 1;
+	    numRuns++;
+	}
+    }
+    return numRuns;
+}
+
 #endif //FILESYS_STUB
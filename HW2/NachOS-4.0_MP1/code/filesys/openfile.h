@@ -38,6 +38,7 @@ class OpenFile {
 	int GetCurrentOffset() {
 		return currentOffset;
 	}
+    void Seek(int position) { currentOffset = position; }
 
     int ReadAt(char *into, int numBytes, int position) { 
     		Lseek(file, position, 0); 
@@ -60,6 +61,8 @@ class OpenFile {
 		}
 
     int Length() { Lseek(file, 0, 2); return Tell(file); }
+
+    int Sector() { return -1; }		// not on the Nachos disk
     
   private:
     int file;
@@ -68,6 +71,16 @@ class OpenFile {
 
 #else // FILESYS
 class FileHeader;
+class Inode;
+
+// A run of file sectors that are also consecutive on disk, as
+// returned by OpenFile::MapRange.
+
+class DiskRun {
+  public:
+    int sector;				// first disk sector of the run
+    int numSectors;			// number of sectors in the run
+};
 
 class OpenFile {
   public:
@@ -93,9 +106,21 @@ class OpenFile {
 					// file (this interface is simpler 
 					// than the UNIX idiom -- lseek to 
 					// end of file, tell, lseek back 
+
+    int Sector();			// Where the file header is; tells
+					// files apart
+
+    int ByteToSector(int offset);	// Same as FileHeader::ByteToSector,
+					// but a single array lookup
+    int MapRange(int offset, int numBytes, DiskRun *runs);
+					// Translate a byte range of the file
+					// into runs of consecutive disk 
+					// sectors; return the # of runs
     
   private:
-    FileHeader *hdr;			// Header for this file 
+    Inode *inode;			// In-core inode, shared by every
+					// OpenFile on this file
+    FileHeader *hdr;			// Header for this file, owned by inode
     int seekPosition;			// Current position within the file
 };
 
@@ -7,7 +7,9 @@
 // of liability and disclaimer of warranty provisions.
 
 #include "copyright.h"
+#include "synchdisk.h"
 #include "pbitmap.h"
+#include "debug.h"
 
 //----------------------------------------------------------------------
 // PersistentBitmap::PersistentBitmap(int)
@@ -21,6 +23,7 @@
 
 PersistentBitmap::PersistentBitmap(int numItems):Bitmap(numItems) 
 { 
+    numClear = numItems;
 }
 
 //----------------------------------------------------------------------
@@ -41,6 +44,22 @@ PersistentBitmap::PersistentBitmap(OpenFile *file, int numItems):Bitmap(numItems
     // but we will just overwrite that with the contents of the
     // map found in the file
     file->ReadAt((char *)map, numWords * sizeof(unsigned), 0);
+    numClear = Bitmap::NumClear();
+}
+
+//----------------------------------------------------------------------
+// PersistentBitmap::PersistentBitmap(OpenFile*,int,int)
+// 	Same as above, but the caller already knows how many bits in
+//	the file are clear, so we don't need to count them.
+//
+//	"numClear" is the number of clear bits in the stored bitmap
+//----------------------------------------------------------------------
+
+PersistentBitmap::PersistentBitmap(OpenFile *file, int numItems, int numClear)
+    :Bitmap(numItems) 
+{ 
+    file->ReadAt((char *)map, numWords * sizeof(unsigned), 0);
+    this->numClear = numClear;
 }
 
 //----------------------------------------------------------------------
@@ -52,6 +71,43 @@ PersistentBitmap::~PersistentBitmap()
 { 
 }
 
+//----------------------------------------------------------------------
+// PersistentBitmap::Mark, PersistentBitmap::Clear, 
+// PersistentBitmap::FindAndSet
+// 	Same as the Bitmap versions, but keep the count of clear bits
+//	in step with the map.
+//----------------------------------------------------------------------
+
+void
+PersistentBitmap::Mark(int which)
+{
+    if (!Test(which)) {
+	numClear--;
+    }
+    Bitmap::Mark(which);
+}
+
+void
+PersistentBitmap::Clear(int which)
+{
+    if (Test(which)) {
+	numClear++;
+    }
+    Bitmap::Clear(which);
+}
+
+int
+PersistentBitmap::FindAndSet()
+{
+    if (numClear == 0) {
+	return -1;
+    }
+    int which = Bitmap::FindAndSet();
+    ASSERT(which >= 0);
+    numClear--;
+    return which;
+}
+
 //----------------------------------------------------------------------
 // PersistentBitmap::FetchFrom
 // 	Initialize the contents of a persistent bitmap from a Nachos file.
@@ -62,7 +118,9 @@ PersistentBitmap::~PersistentBitmap()
 void
 PersistentBitmap::FetchFrom(OpenFile *file) 
 {
+    DiskLayerScope scope(LayerBitmap);
     file->ReadAt((char *)map, numWords * sizeof(unsigned), 0);
+    numClear = Bitmap::NumClear();
 }
 
 //----------------------------------------------------------------------
@@ -75,5 +133,6 @@ PersistentBitmap::FetchFrom(OpenFile *file)
 void
 PersistentBitmap::WriteBack(OpenFile *file)
 {
+   DiskLayerScope scope(LayerBitmap);
    file->WriteAt((char *)map, numWords * sizeof(unsigned), 0);
 }
@@ -20,16 +20,31 @@
 // The following class defines a persistent bitmap.  It inherits all
 // the behavior of a bitmap (see bitmap.h), adding the ability to
 // be read from and stored to the disk.
+//
+// A persistent bitmap also keeps count of its clear bits, so that
+// NumClear doesn't have to scan the whole map.  When the count is 
+// already known (the file system keeps it in the superblock), it can 
+// be handed to the constructor; otherwise it is counted once.
 
 class PersistentBitmap : public Bitmap {
   public:
     PersistentBitmap(OpenFile *file,int numItems); //initialize bitmap from disk 
+    PersistentBitmap(OpenFile *file, int numItems, int numClear);
+					// ditto, number of clear bits known
     PersistentBitmap(int numItems); // or don't...
 
     ~PersistentBitmap(); 			// deallocate bitmap
 
+    void Mark(int which);		// same as for Bitmap, but keep
+    void Clear(int which);		// numClear up to date
+    int FindAndSet();
+    int NumClear() const { return numClear; }
+
     void FetchFrom(OpenFile *file);     // read bitmap from the disk
     void WriteBack(OpenFile *file); 	// write bitmap contents to disk 
+
+  private:
+    int numClear;			// number of clear bits in the map
 };
 
 #endif // PBITMAP_H
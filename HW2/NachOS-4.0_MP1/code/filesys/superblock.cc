@@ -0,0 +1,103 @@
+// superblock.cc
+//	Routines for managing the file system superblock.
+//
+//	On disk, the superblock is an array of ints, one field per
+//	entry, padded out to a whole sector:
+//
+//	   magic, version, sectorSize, numSectors,
+//	   numFreeSectors, numInodes, clean
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "superblock.h"
+
+#include "copyright.h"
+#include "debug.h"
+#include "main.h"
+#include "synchdisk.h"
+
+//----------------------------------------------------------------------
+// SuperBlock::SuperBlock
+// 	Initialize a superblock describing an empty disk with the
+//	geometry Nachos was compiled with.  The caller fills in the
+//	counters once the free map and root directory are laid out.
+//----------------------------------------------------------------------
+
+SuperBlock::SuperBlock() {
+    magic = SUPERBLOCK_MAGIC;
+    version = FS_VERSION;
+    sectorSize = SectorSize;
+    numSectors = NumSectors;
+    numFreeSectors = NumSectors;
+    numInodes = 0;
+    clean = TRUE;
+}
+
+//----------------------------------------------------------------------
+// SuperBlock::FetchFrom
+// 	Fetch the contents of the superblock from disk.
+//
+//	"sector" is the disk sector containing the superblock
+//----------------------------------------------------------------------
+
+void SuperBlock::FetchFrom(int sector) {
+    DiskLayerScope scope(LayerSuper);
+    int cacheArraySize = SectorSize / sizeof(int);
+    int cache[cacheArraySize];
+    memset(cache, 0, sizeof(cache));
+    kernel->synchDisk->ReadSector(sector, (char *)cache);
+    magic = cache[0];
+    version = cache[1];
+    sectorSize = cache[2];
+    numSectors = cache[3];
+    numFreeSectors = cache[4];
+    numInodes = cache[5];
+    clean = (cache[6] != 0);
+}
+
+//----------------------------------------------------------------------
+// SuperBlock::WriteBack
+// 	Write the superblock back to disk.
+//
+//	"sector" is the disk sector to contain the superblock
+//----------------------------------------------------------------------
+
+void SuperBlock::WriteBack(int sector) {
+    DiskLayerScope scope(LayerSuper);
+    int cacheArraySize = SectorSize / sizeof(int);
+    int cache[cacheArraySize];
+    memset(cache, 0, sizeof(cache));
+    cache[0] = magic;
+    cache[1] = version;
+    cache[2] = sectorSize;
+    cache[3] = numSectors;
+    cache[4] = numFreeSectors;
+    cache[5] = numInodes;
+    cache[6] = clean ? 1 : 0;
+    kernel->synchDisk->WriteSector(sector, (char *)cache);
+}
+
+//----------------------------------------------------------------------
+// SuperBlock::IsValid
+// 	Return TRUE if the superblock was written by this version of
+//	the file system, for a disk with the same geometry.
+//----------------------------------------------------------------------
+
+bool SuperBlock::IsValid() {
+    return magic == SUPERBLOCK_MAGIC && version == FS_VERSION &&
+           sectorSize == SectorSize && numSectors == NumSectors;
+}
+
+//----------------------------------------------------------------------
+// SuperBlock::Print
+// 	Print the contents of the superblock.
+//----------------------------------------------------------------------
+
+void SuperBlock::Print() {
+    printf("Superblock: version %d, %d sectors of %d bytes\n",
+           version, numSectors, sectorSize);
+    printf("Free sectors: %d, file headers in use: %d, %s\n",
+           numFreeSectors, numInodes, clean ? "clean" : "not clean");
+}
@@ -0,0 +1,67 @@
+// superblock.h
+//	Data structures for the file system superblock.
+//
+//	The superblock sits in a well-known sector and summarizes the
+//	whole file system: the geometry and format version the disk was
+//	formatted with, how many sectors are still free, how many file
+//	headers (i-nodes) are in use, and whether the file system was
+//	cleanly unmounted.
+//
+//	It is read once when the file system is mounted and kept in
+//	memory; every operation that changes the counters writes it back,
+//	so questions like "is there room for this file?" never have to
+//	scan the free sector map.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef SUPERBLOCK_H
+#define SUPERBLOCK_H
+
+#include "disk.h"
+
+#define SUPERBLOCK_MAGIC 0x53555052  // "SUPR"
+#define FS_VERSION 4                 // bump whenever the on-disk layout changes
+
+// The following class defines the Nachos superblock.  Like a file
+// header, it occupies exactly one disk sector, and the FetchFrom/WriteBack
+// operations move it between memory and disk.
+
+class SuperBlock {
+   public:
+    SuperBlock();  // Initialize a superblock for a freshly
+                   // formatted disk with the current geometry
+
+    void FetchFrom(int sector);  // Read the superblock from disk
+    void WriteBack(int sector);  // Write it back to disk
+
+    bool IsValid();  // Was the disk formatted by a
+                     // compatible file system?
+
+    int FreeSectors() { return numFreeSectors; }
+    void SetFreeSectors(int n) { numFreeSectors = n; }
+
+    int NumInodes() { return numInodes; }
+    void SetNumInodes(int n) { numInodes = n; }
+    void AddInodes(int delta) { numInodes += delta; }
+
+    bool IsClean() { return clean; }
+    void SetClean(bool isClean) { clean = isClean; }
+
+    void Print();  // Print the contents of the superblock
+
+   private:
+    int magic;           // SUPERBLOCK_MAGIC
+    int version;         // FS_VERSION at format time
+    int sectorSize;      // geometry at format time
+    int numSectors;
+    int numFreeSectors;  // sectors not marked in the free map
+    int numInodes;       // file headers in use, including the
+                         // free map and the root directory
+    bool clean;          // TRUE if unmounted cleanly
+};
+
+#endif  // SUPERBLOCK_H
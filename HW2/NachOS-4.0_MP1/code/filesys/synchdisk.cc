@@ -16,6 +16,15 @@
 
 #include "copyright.h"
 #include "synchdisk.h"
+#include "main.h"
+
+static const char *layerNames[NumDiskLayers] = {
+    "data", "header", "directory", "bitmap", "superblock", "swap"
+};
+
+static const char *operationNames[NumFsOperations] = {
+    "Other", "Create", "Open", "Remove", "List", "ReadFile", "WriteFile"
+};
 
 
 //----------------------------------------------------------------------
@@ -30,6 +39,11 @@ SynchDisk::SynchDisk()
     semaphore = new Semaphore("synch disk", 0);
     lock = new Lock("synch disk lock");
     disk = new Disk(this);
+    layer = LayerData;
+    operation = FsOther;
+    for (int op = 0; op < NumFsOperations; op++)
+	for (int l = 0; l < NumDiskLayers; l++)
+	    reads[op][l] = writes[op][l] = 0;
 }
 
 //----------------------------------------------------------------------
@@ -56,9 +70,27 @@ SynchDisk::~SynchDisk()
 
 void
 SynchDisk::ReadSector(int sectorNumber, char* data)
+{
+    ReadSectors(sectorNumber, data, 1);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadSectors
+// 	Read "numSectors" consecutive disk sectors into a buffer, with one
+//	disk request.  Return only after the data has been read.  The
+//	profile still counts every sector.
+//
+//	"sectorNumber" -- the first disk sector to read
+//	"data" -- the buffer, "numSectors" sectors long
+//	"numSectors" -- how many sectors to read
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadSectors(int sectorNumber, char* data, int numSectors)
 {
     lock->Acquire();			// only one disk I/O at a time
-    disk->ReadRequest(sectorNumber, data);
+    reads[operation][layer] += numSectors;
+    disk->ReadRequest(sectorNumber, data, numSectors);
     semaphore->P();			// wait for interrupt
     lock->Release();
 }
@@ -74,9 +106,26 @@ SynchDisk::ReadSector(int sectorNumber, char* data)
 
 void
 SynchDisk::WriteSector(int sectorNumber, char* data)
+{
+    WriteSectors(sectorNumber, data, 1);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::WriteSectors
+// 	Write a buffer into "numSectors" consecutive disk sectors, with
+//	one disk request.  Return only after the data has been written.
+//
+//	"sectorNumber" -- the first disk sector to be written
+//	"data" -- the new contents, "numSectors" sectors long
+//	"numSectors" -- how many sectors to write
+//----------------------------------------------------------------------
+
+void
+SynchDisk::WriteSectors(int sectorNumber, char* data, int numSectors)
 {
     lock->Acquire();			// only one disk I/O at a time
-    disk->WriteRequest(sectorNumber, data);
+    writes[operation][layer] += numSectors;
+    disk->WriteRequest(sectorNumber, data, numSectors);
     semaphore->P();			// wait for interrupt
     lock->Release();
 }
@@ -92,3 +141,86 @@ SynchDisk::CallBack()
 { 
     semaphore->V();
 }
+
+//----------------------------------------------------------------------
+// SynchDisk::SetLayer/SetOperation
+// 	Charge the disk accesses from now on to another file system layer
+//	or operation.  Return the one they were charged to before, for the
+//	caller to put back.  Use DiskLayerScope/FsOperationScope rather
+//	than calling these directly.
+//----------------------------------------------------------------------
+
+DiskLayer
+SynchDisk::SetLayer(DiskLayer newLayer)
+{
+    DiskLayer old = layer;
+    layer = newLayer;
+    return old;
+}
+
+FsOperation
+SynchDisk::SetOperation(FsOperation newOp)
+{
+    FsOperation old = operation;
+    operation = newOp;
+    return old;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::PrintProfile
+// 	Print, for each file system operation that touched the disk, how
+//	many sectors each layer of the file system read and wrote, as
+//	"reads/writes".
+//----------------------------------------------------------------------
+
+void
+SynchDisk::PrintProfile()
+{
+    cout << "File system I/O (reads/writes):";
+    for (int l = 0; l < NumDiskLayers; l++)
+	cout << " " << layerNames[l];
+    cout << "\n";
+    for (int op = 0; op < NumFsOperations; op++) {
+	int total = 0;
+	for (int l = 0; l < NumDiskLayers; l++)
+	    total += reads[op][l] + writes[op][l];
+	if (total == 0)
+	    continue;
+	cout << "    " << operationNames[op] << ":";
+	for (int l = 0; l < NumDiskLayers; l++)
+	    cout << " " << reads[op][l] << "/" << writes[op][l];
+	cout << "\n";
+    }
+}
+
+//----------------------------------------------------------------------
+// DiskLayerScope::DiskLayerScope/~DiskLayerScope
+// 	Charge disk accesses to "layer" for the lifetime of the object.
+//----------------------------------------------------------------------
+
+DiskLayerScope::DiskLayerScope(DiskLayer layer)
+{
+    saved = kernel->synchDisk->SetLayer(layer);
+}
+
+DiskLayerScope::~DiskLayerScope()
+{
+    kernel->synchDisk->SetLayer(saved);
+}
+
+//----------------------------------------------------------------------
+// FsOperationScope::FsOperationScope/~FsOperationScope
+// 	Charge disk accesses to "op" for the lifetime of the object, if
+//	no other operation is under way.
+//----------------------------------------------------------------------
+
+FsOperationScope::FsOperationScope(FsOperation op)
+{
+    saved = kernel->synchDisk->SetOperation(FsOther);
+    kernel->synchDisk->SetOperation(saved == FsOther ? op : saved);
+}
+
+FsOperationScope::~FsOperationScope()
+{
+    kernel->synchDisk->SetOperation(saved);
+}
@@ -15,6 +15,31 @@
 #include "synch.h"
 #include "callback.h"
 
+// For the file system profile, every sector read or written is
+// charged to the layer of the file system that asked for it, and to
+// the file system operation that was in progress at the time.
+
+enum DiskLayer {
+    LayerData,				// contents of a file
+    LayerHeader,			// file headers and index blocks
+    LayerDirectory,			// directory contents
+    LayerBitmap,			// free sector map
+    LayerSuper,				// superblock
+    LayerSwap,				// pages of user programs
+    NumDiskLayers
+};
+
+enum FsOperation {
+    FsOther,				// formatting, -cp, etc.
+    FsCreate,
+    FsOpen,
+    FsRemove,
+    FsList,
+    FsRead,
+    FsWrite,
+    NumFsOperations
+};
+
 // The following class defines a "synchronous" disk abstraction.
 // As with other I/O devices, the raw physical disk is an asynchronous device --
 // requests to read or write portions of the disk return immediately,
@@ -39,12 +64,30 @@ class SynchDisk : public CallBackObj {
     					// Disk::ReadRequest/WriteRequest and
 					// then wait until the request is done.
     void WriteSector(int sectorNumber, char* data);
+    void ReadSectors(int sectorNumber, char* data, int numSectors);
+    void WriteSectors(int sectorNumber, char* data, int numSectors);
+    					// Likewise for "numSectors"
+					// consecutive sectors, in a single
+					// disk request
     
     void CallBack();			// Called by the disk device interrupt
 					// handler, to signal that the
 					// current disk operation is complete.
 
+    DiskLayer SetLayer(DiskLayer newLayer);
+					// Charge accesses to "newLayer" from
+					// now on; return the old layer
+    FsOperation SetOperation(FsOperation newOp);
+					// Likewise for the operation
+    void PrintProfile();		// Print sector reads and writes,
+					// by operation and layer
+
   private:
+    DiskLayer layer;			// who the next access is for
+    FsOperation operation;
+    int reads[NumFsOperations][NumDiskLayers];
+    int writes[NumFsOperations][NumDiskLayers];
+
     Disk *disk;		  		// Raw disk device
     Semaphore *semaphore; 		// To synchronize requesting thread 
 					// with the interrupt handler
@@ -52,4 +95,29 @@ class SynchDisk : public CallBackObj {
 					// can be sent to the disk at a time
 };
 
+// Charge the disk accesses made while one of these is in scope to
+// "layer", then go back to whatever layer they were charged to before.
+
+class DiskLayerScope {
+  public:
+    DiskLayerScope(DiskLayer layer);
+    ~DiskLayerScope();
+
+  private:
+    DiskLayer saved;
+};
+
+// Charge the disk accesses made while one of these is in scope to the
+// file system operation "op", unless they are part of an operation
+// that was already under way (Open, say, called by Remove).
+
+class FsOperationScope {
+  public:
+    FsOperationScope(FsOperation op);
+    ~FsOperationScope();
+
+  private:
+    FsOperation saved;
+};
+
 #endif // SYNCHDISK_H
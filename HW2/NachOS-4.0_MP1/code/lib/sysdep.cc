@@ -29,6 +29,7 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <sys/time.h>
+#include <time.h>
 #include <sys/file.h>
 #include <sys/socket.h>
 #include <sys/un.h>
@@ -149,6 +150,23 @@ UDelay(unsigned int useconds)
 
 }
 
+//----------------------------------------------------------------------
+// HostNanoseconds
+// 	Return the time on a monotonic host clock, in nanoseconds.  Only
+//	differences between two calls mean anything; used to measure how
+//	long the host takes to simulate something, as opposed to the
+//	simulated time kept in "ticks".
+//----------------------------------------------------------------------
+
+long long
+HostNanoseconds()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long) now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
 //----------------------------------------------------------------------
 // Abort
 // 	Quit and drop core.
@@ -22,17 +22,26 @@
 // We put a magic number at the front of the UNIX file representing the
 // disk, to make it less likely we will accidentally treat a useful file 
 // as a disk (which would probably trash the file's contents).
+//
+// Right behind the magic number we record the geometry the disk was
+// created with, so that a Nachos compiled with a different SECTOR_SIZE
+// does not silently misread it.
 
 const int MagicNumber = 0x456789ab;
 const int MagicSize = sizeof(int);
-const int DiskSize = (MagicSize + (NumSectors * SectorSize));
+const int GeometrySize = 3 * sizeof(int);	// sector size, sectors/track, tracks
+const int HeaderSize = MagicSize + GeometrySize;
+const int DiskSize = (HeaderSize + (NumSectors * SectorSize));
 
 
 //----------------------------------------------------------------------
 // Disk::Disk()
 // 	Initialize a simulated disk.  Open the UNIX file (creating it
 //	if it doesn't exist), and check the magic number to make sure it's 
-// 	ok to treat it as Nachos disk storage.
+// 	ok to treat it as Nachos disk storage.  A disk created with a
+//	different geometry can't be read.  If the disk is about to be
+//	formatted (-f), it is replaced by an empty one; if not, Nachos
+//	stops rather than touch it.
 //
 //	"toCall" -- object to call when disk read/write request completes
 //----------------------------------------------------------------------
@@ -40,7 +49,13 @@ const int DiskSize = (MagicSize + (NumSectors * SectorSize));
 Disk::Disk(CallBackObj *toCall)
 {
     int magicNum;
+    int geometry[3];
     int tmp = 0;
+#ifndef FILESYS_STUB
+    bool formatting = kernel->formatFlag;
+#else
+    bool formatting = FALSE;
+#endif
 
     DEBUG(dbgDisk, "Initializing the disk.");
     callWhenDone = toCall;
@@ -52,10 +67,32 @@ Disk::Disk(CallBackObj *toCall)
     if (fileno >= 0) {		 	// file exists, check magic number 
 	Read(fileno, (char *) &magicNum, MagicSize);
 	ASSERT(magicNum == MagicNumber);
-    } else {				// file doesn't exist, create it
+	Read(fileno, (char *) geometry, GeometrySize);
+	if (geometry[0] != SectorSize || geometry[1] != SectorsPerTrack
+				|| geometry[2] != NumTracks) {
+	    cerr << diskname << " was created with " << geometry[0] 
+		<< "-byte sectors, " << geometry[1] << " sectors/track, "
+		<< geometry[2] << " tracks, but this Nachos uses " 
+		<< SectorSize << "-byte sectors, " << SectorsPerTrack 
+		<< " sectors/track, " << NumTracks << " tracks.\n";
+	    if (!formatting) {
+		cerr << "Run Nachos with -f to replace it with an empty disk.\n";
+		Abort();
+	    }
+	    cerr << "Replacing it with an empty disk.\n";
+	    Close(fileno);
+	    fileno = -1;
+	}
+    }
+    if (fileno < 0) {			// file doesn't exist (any more),
+					// create it
         fileno = OpenForWrite(diskname);
 	magicNum = MagicNumber;  
 	WriteFile(fileno, (char *) &magicNum, MagicSize); // write magic number
+	geometry[0] = SectorSize;
+	geometry[1] = SectorsPerTrack;
+	geometry[2] = NumTracks;
+	WriteFile(fileno, (char *) geometry, GeometrySize);
 
 	// need to write at end of file, so that reads will not return EOF
         Lseek(fileno, DiskSize - sizeof(int), 0);	
@@ -106,46 +143,76 @@ PrintSector (bool writing, int sector, char *data)
 //	Note that a disk only allows an entire sector to be read/written,
 //	not part of a sector.
 //
-//	"sectorNumber" -- the disk sector to read/write
+//	A request may cover several consecutive sectors.  Once the head
+//	is at the first, the others follow one per RotationTime (plus a
+//	seek to the next track wherever the run crosses one), so one
+//	request for the run costs much less than a request per sector.
+//
+//	"sectorNumber" -- the (first) disk sector to read/write
 //	"data" -- the bytes to be written, the buffer to hold the incoming bytes
+//	"numSectors" -- how many sectors, if more than one
 //----------------------------------------------------------------------
 
 void
 Disk::ReadRequest(int sectorNumber, char* data)
 {
-    int ticks = ComputeLatency(sectorNumber, FALSE);
+    ReadRequest(sectorNumber, data, 1);
+}
+
+void
+Disk::WriteRequest(int sectorNumber, char* data)
+{
+    WriteRequest(sectorNumber, data, 1);
+}
+
+void
+Disk::ReadRequest(int sectorNumber, char* data, int numSectors)
+{
+    int endSector = sectorNumber + numSectors - 1;
+    int ticks = ComputeLatency(sectorNumber, FALSE) 
+		+ (numSectors - 1) * RotationTime
+		+ (endSector / SectorsPerTrack - sectorNumber / SectorsPerTrack) 
+			* SeekTime;
 
     ASSERT(!active);				// only one request at a time
-    ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
+    ASSERT((sectorNumber >= 0) && (numSectors > 0) 
+		&& (endSector < NumSectors));
     
-    DEBUG(dbgDisk, "Reading from sector " << sectorNumber);
-    Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    Read(fileno, data, SectorSize);
+    DEBUG(dbgDisk, "Reading from sector " << sectorNumber << ", " << numSectors << " sectors");
+    Lseek(fileno, SectorSize * sectorNumber + HeaderSize, 0);
+    Read(fileno, data, SectorSize * numSectors);
     if (debug->IsEnabled('d'))
-	PrintSector(FALSE, sectorNumber, data);
+	for (int i = 0; i < numSectors; i++)
+	    PrintSector(FALSE, sectorNumber + i, &data[i * SectorSize]);
     
     active = TRUE;
-    UpdateLast(sectorNumber);
+    UpdateLast(endSector);
     kernel->stats->numDiskReads++;
     kernel->interrupt->Schedule(this, ticks, DiskInt);
 }
 
 void
-Disk::WriteRequest(int sectorNumber, char* data)
+Disk::WriteRequest(int sectorNumber, char* data, int numSectors)
 {
-    int ticks = ComputeLatency(sectorNumber, TRUE);
+    int endSector = sectorNumber + numSectors - 1;
+    int ticks = ComputeLatency(sectorNumber, TRUE)
+		+ (numSectors - 1) * RotationTime
+		+ (endSector / SectorsPerTrack - sectorNumber / SectorsPerTrack) 
+			* SeekTime;
 
     ASSERT(!active);
-    ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
+    ASSERT((sectorNumber >= 0) && (numSectors > 0) 
+		&& (endSector < NumSectors));
     
-    DEBUG(dbgDisk, "Writing to sector " << sectorNumber);
-    Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    WriteFile(fileno, data, SectorSize);
+    DEBUG(dbgDisk, "Writing to sector " << sectorNumber << ", " << numSectors << " sectors");
+    Lseek(fileno, SectorSize * sectorNumber + HeaderSize, 0);
+    WriteFile(fileno, data, SectorSize * numSectors);
     if (debug->IsEnabled('d'))
-	PrintSector(TRUE, sectorNumber, data);
+	for (int i = 0; i < numSectors; i++)
+	    PrintSector(TRUE, sectorNumber + i, &data[i * SectorSize]);
     
     active = TRUE;
-    UpdateLast(sectorNumber);
+    UpdateLast(endSector);
     kernel->stats->numDiskWrites++;
     kernel->interrupt->Schedule(this, ticks, DiskInt);
 }
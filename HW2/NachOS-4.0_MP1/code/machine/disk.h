@@ -46,10 +46,37 @@
 // disks these days now come with a track buffer.
 //
 // The track buffer simulation can be disabled by compiling with -DNOTRACKBUF
+//
+// The disk geometry can also be chosen when Nachos is compiled, by adding
+// eg. -DSECTOR_SIZE=512 or -DSECTOR_SIZE=4096 to DEFINES in the Makefile.
+// Unless NUM_TRACKS is given as well, the number of tracks is derived
+// from the sector size so that the disk always holds DiskCapacity bytes.
+// The geometry is recorded in the UNIX file when the disk is created, 
+// and a disk made with a different geometry is only replaced, by an
+// empty one, when Nachos is asked to format the disk (-f).
+
+#ifndef SECTOR_SIZE
+#define SECTOR_SIZE 128
+#endif
+
+#ifndef SECTORS_PER_TRACK
+#define SECTORS_PER_TRACK 4
+#endif
+
+#if (SECTOR_SIZE < 128) || (SECTOR_SIZE & (SECTOR_SIZE - 1))
+#error "SECTOR_SIZE must be a power of two, at least 128 bytes"
+#endif
+
+const int DiskCapacity = 128 * 4 * 147456;	// 72MB, the original geometry
+
+#ifndef NUM_TRACKS
+#define NUM_TRACKS (DiskCapacity / (SECTOR_SIZE * SECTORS_PER_TRACK))
+#endif
 
-const int SectorSize = 128;		// number of bytes per disk sector
-const int SectorsPerTrack  = 4;	// number of sectors per disk track 
-const int NumTracks = 147456;		// number of tracks per disk, one more for metadata
+const int SectorSize = SECTOR_SIZE;	// number of bytes per disk sector
+const int SectorsPerTrack = SECTORS_PER_TRACK;	
+					// number of sectors per disk track 
+const int NumTracks = NUM_TRACKS;	// number of tracks per disk
 
 const int NumSectors = (SectorsPerTrack * NumTracks);
 					// total # of sectors per disk
@@ -67,6 +94,11 @@ class Disk : public CallBackObj {
     					// the disk and return immediately.
     					// Only one request allowed at a time!
     void WriteRequest(int sectorNumber, char* data);
+    void ReadRequest(int sectorNumber, char* data, int numSectors);
+    void WriteRequest(int sectorNumber, char* data, int numSectors);
+					// Read/write "numSectors" consecutive
+					// sectors with a single request; the
+					// head only has to get to the first
 
     void CallBack();			// Invoked when disk request 
 					// finishes. In turn calls, callWhenDone.
@@ -23,6 +23,7 @@
 #include "copyright.h"
 #include "interrupt.h"
 #include "main.h"
+#include "synchdisk.h"
 
 // String definitions for debugging messages
 
@@ -39,27 +40,147 @@ static char *intTypeNames[] = { "timer", "disk", "console write",
 //	"callOnInt" is the object to call when the interrupt occurs
 //	"time" is when (in simulated time) the interrupt is to occur
 //	"kind" is the hardware device that generated the interrupt
+//	"order" says when it was scheduled relative to the others
 //----------------------------------------------------------------------
 
 PendingInterrupt::PendingInterrupt(CallBackObj *callOnInt, 
-					int time, IntType kind)
+					int time, IntType kind,
+					unsigned int order)
 {
     callOnInterrupt = callOnInt;
     when = time;
     type = kind;
+    seq = order;
 }
 
 //----------------------------------------------------------------------
-// PendingCompare
-//	Compare to interrupts based on which should occur first.
+// PendingBefore
+//	Return TRUE if interrupt "x" should occur before "y": it is due
+//	earlier, or at the same time but was scheduled first.
 //----------------------------------------------------------------------
 
-static int
-PendingCompare (PendingInterrupt *x, PendingInterrupt *y)
+static bool
+PendingBefore (PendingInterrupt *x, PendingInterrupt *y)
 {
-    if (x->when < y->when) { return -1; }
-    else if (x->when > y->when) { return 1; }
-    else { return 0; }
+    if (x->when != y->when) { return x->when < y->when; }
+    return (int) (x->seq - y->seq) < 0;	// survives wrap-around
+}
+
+//----------------------------------------------------------------------
+// PendingQueue::PendingQueue
+// 	Initialize an empty queue of pending interrupts.  There are
+//	rarely more than a handful pending -- a timer, a disk request,
+//	the console -- so the array starts small.
+//----------------------------------------------------------------------
+
+PendingQueue::PendingQueue()
+{
+    capacity = 16;
+    heap = new PendingInterrupt[capacity];
+    numPending = 0;
+    nextSeq = 0;
+}
+
+//----------------------------------------------------------------------
+// PendingQueue::~PendingQueue
+// 	De-allocate the queue, and whatever is still pending in it.
+//----------------------------------------------------------------------
+
+PendingQueue::~PendingQueue()
+{
+    delete [] heap;
+}
+
+//----------------------------------------------------------------------
+// PendingQueue::Insert
+// 	Add an interrupt to the heap: put it at the bottom, and move it
+//	up past every interrupt that should occur after it.  Doubles the
+//	array if it is full.
+//
+//	"callOnInt" is the object to call when the interrupt occurs
+//	"when" is when (in simulated time) the interrupt is to occur
+//	"type" is the hardware device that generated the interrupt
+//----------------------------------------------------------------------
+
+void
+PendingQueue::Insert(CallBackObj *callOnInt, int when, IntType type)
+{
+    PendingInterrupt item(callOnInt, when, type, nextSeq++);
+    int i, parent;
+
+    if (numPending == capacity) {
+	PendingInterrupt *bigger = new PendingInterrupt[capacity * 2];
+	for (i = 0; i < numPending; i++) {
+	    bigger[i] = heap[i];
+	}
+	delete [] heap;
+	heap = bigger;
+	capacity *= 2;
+    }
+    for (i = numPending++; i > 0; i = parent) {
+	parent = (i - 1) / 2;
+	if (!PendingBefore(&item, &heap[parent])) {
+	    break;
+	}
+	heap[i] = heap[parent];
+    }
+    heap[i] = item;
+}
+
+//----------------------------------------------------------------------
+// PendingQueue::RemoveFront
+// 	Take the first interrupt off the heap, and return a copy of it.
+//	The last interrupt in the array takes its place and moves down
+//	past every interrupt that should occur before it.
+//----------------------------------------------------------------------
+
+PendingInterrupt
+PendingQueue::RemoveFront()
+{
+    PendingInterrupt first = heap[0];
+    PendingInterrupt item;
+    int i, child;
+
+    ASSERT(numPending > 0);
+    item = heap[--numPending];
+    for (i = 0; (child = 2 * i + 1) < numPending; i = child) {
+	if (child + 1 < numPending && PendingBefore(&heap[child + 1], &heap[child])) {
+	    child++;			// the earlier of the two children
+	}
+	if (!PendingBefore(&heap[child], &item)) {
+	    break;
+	}
+	heap[i] = heap[child];
+    }
+    heap[i] = item;
+    return first;
+}
+
+//----------------------------------------------------------------------
+// PendingQueue::Apply
+// 	Call "func" on every pending interrupt, in the order they will
+//	occur.  The heap isn't in that order, so sort a copy; this is
+//	only used for debugging.
+//----------------------------------------------------------------------
+
+void
+PendingQueue::Apply(void (*func)(PendingInterrupt *))
+{
+    PendingInterrupt *sorted = new PendingInterrupt[numPending + 1];
+    PendingInterrupt item;
+    int i, j;
+
+    for (i = 0; i < numPending; i++) {	// insertion sort
+	item = heap[i];
+	for (j = i; j > 0 && PendingBefore(&item, &sorted[j - 1]); j--) {
+	    sorted[j] = sorted[j - 1];
+	}
+	sorted[j] = item;
+    }
+    for (i = 0; i < numPending; i++) {
+	(*func)(&sorted[i]);
+    }
+    delete [] sorted;
 }
 
 //----------------------------------------------------------------------
@@ -72,10 +193,12 @@ PendingCompare (PendingInterrupt *x, PendingInterrupt *y)
 Interrupt::Interrupt()
 {
     level = IntOff;
-    pending = new SortedList<PendingInterrupt *>(PendingCompare);
+    pending = new PendingQueue();
     inHandler = FALSE;
     yieldOnReturn = FALSE;
     status = SystemMode;
+    nextDue = NeverDue;
+    traceTicks = debug->IsEnabled(dbgInt);
 }
 
 //----------------------------------------------------------------------
@@ -85,9 +208,6 @@ Interrupt::Interrupt()
 
 Interrupt::~Interrupt()
 {
-    while (!pending->IsEmpty()) {
-	delete pending->RemoveFront();
-    }
     delete pending;
 }
 
@@ -143,20 +263,33 @@ Interrupt::SetLevel(IntStatus now)
 //	Two things can cause OneTick to be called:
 //		interrupts are re-enabled
 //		a user instruction is executed
+//
+//	The basic block interpreter runs several user instructions and
+//	then calls OneTick once for all of them; it makes sure no
+//	interrupt comes due part way through (see NextDue).
+//
+//	This runs after every user instruction, so the usual case --
+//	nothing due yet -- is just advancing the clock and comparing it
+//	with the cached time of the first pending interrupt.
+//
+//	"count" -- how many ticks to advance time by
 //----------------------------------------------------------------------
 void
-Interrupt::OneTick()
+Interrupt::OneTick(int count)
 {
     MachineStatus oldStatus = status;
     Statistics *stats = kernel->stats;
 
 // advance simulated time
     if (status == SystemMode) {
-        stats->totalTicks += SystemTick;
-	stats->systemTicks += SystemTick;
+        stats->totalTicks += count * SystemTick;
+	stats->systemTicks += count * SystemTick;
     } else {
-	stats->totalTicks += UserTick;
-	stats->userTicks += UserTick;
+	stats->totalTicks += count * UserTick;
+	stats->userTicks += count * UserTick;
+    }
+    if (stats->totalTicks < nextDue && !yieldOnReturn && !traceTicks) {
+	return;			// nothing to do yet
     }
     DEBUG(dbgInt, "== Tick " << stats->totalTicks << " ==");
 
@@ -229,13 +362,19 @@ Interrupt::Idle()
 //----------------------------------------------------------------------
 // Interrupt::Halt
 // 	Shut down Nachos cleanly, printing out performance statistics.
+//	With -P, print the statistics (with the per-system-call profile)
+//	and the file system I/O profile.
 //----------------------------------------------------------------------
 void
 Interrupt::Halt()
 {
     // cout << "Machine halting!\n\n";
     // cout << "This is halt\n";
-    // kernel->stats->Print();
+    if (kernel->printSyscallStats) {
+	kernel->stats->Print();
+	kernel->stats->PrintSyscallsMachine();
+	kernel->synchDisk->PrintProfile();
+    }
     delete kernel;	// Never returns.
 }
 
@@ -284,13 +423,37 @@ Interrupt::ReadFile(char *buffer, int size, OpenFileId fd)
     return kernel->fileSystem->ReadFile(buffer, size, fd);
 }
 
+int 
+Interrupt::PWriteFile(char *buffer, int size, int position, OpenFileId fd)
+{
+    return kernel->fileSystem->PWriteFile(buffer, size, position, fd);
+}
+
+int 
+Interrupt::PReadFile(char *buffer, int size, int position, OpenFileId fd)
+{
+    return kernel->fileSystem->PReadFile(buffer, size, position, fd);
+}
+
+int 
+Interrupt::SeekFile(int position, OpenFileId fd)
+{
+    return kernel->fileSystem->SeekFile(position, fd);
+}
+
+int 
+Interrupt::RemoveFile(char *filename)
+{
+    return kernel->fileSystem->Remove(filename) ? 1 : 0;
+}
+
 
 //----------------------------------------------------------------------
 // Interrupt::Schedule
 // 	Arrange for the CPU to be interrupted when simulated time
 //	reaches "now + when".
 //
-//	Implementation: just put it on a sorted list.
+//	Implementation: just put it on the heap of pending interrupts.
 //
 //	NOTE: the Nachos kernel should not call this routine directly.
 //	Instead, it is only called by the hardware device simulators.
@@ -304,12 +467,14 @@ void
 Interrupt::Schedule(CallBackObj *toCall, int fromNow, IntType type)
 {
     int when = kernel->stats->totalTicks + fromNow;
-    PendingInterrupt *toOccur = new PendingInterrupt(toCall, when, type);
 
     DEBUG(dbgInt, "Scheduling interrupt handler the " << intTypeNames[type] << " at time = " << when);
     ASSERT(fromNow > 0);
 
-    pending->Insert(toOccur);
+    pending->Insert(toCall, when, type);
+    if (when < nextDue) {
+	nextDue = when;
+    }
 }
 
 //----------------------------------------------------------------------
@@ -328,6 +493,7 @@ bool
 Interrupt::CheckIfDue(bool advanceClock)
 {
     PendingInterrupt *next;
+    PendingInterrupt fired;
     Statistics *stats = kernel->stats;
 
     ASSERT(level == IntOff);		// interrupts need to be disabled,
@@ -360,12 +526,12 @@ Interrupt::CheckIfDue(bool advanceClock)
 
     inHandler = TRUE;
     do {
-        next = pending->RemoveFront();    // pull interrupt off list
-        next->callOnInterrupt->CallBack();// call the interrupt handler
-	delete next;
+        fired = pending->RemoveFront();   // pull interrupt off the heap
+        fired.callOnInterrupt->CallBack();// call the interrupt handler
     } while (!pending->IsEmpty() 
     		&& (pending->Front()->when <= stats->totalTicks));
     inHandler = FALSE;
+    nextDue = pending->IsEmpty() ? NeverDue : pending->Front()->when;
     return TRUE;
 }
 
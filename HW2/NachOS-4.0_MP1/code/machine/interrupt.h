@@ -51,6 +51,8 @@ enum MachineStatus {IdleMode, SystemMode, UserMode};
 // IntType records which hardware device generated an interrupt.
 // In Nachos, we support a hardware timer device, a disk, a console
 // display and keyboard, and a network.
+const int NeverDue = 0x7fffffff;	// nextDue with nothing pending
+
 enum IntType { TimerInt, DiskInt, ConsoleWriteInt, ConsoleReadInt, 
 			NetworkSendInt, NetworkRecvInt};
 
@@ -60,7 +62,9 @@ enum IntType { TimerInt, DiskInt, ConsoleWriteInt, ConsoleReadInt,
 
 class PendingInterrupt {
   public:
-    PendingInterrupt(CallBackObj *callOnInt, int time, IntType kind);
+    PendingInterrupt() {}	// an unused slot in a PendingQueue
+    PendingInterrupt(CallBackObj *callOnInt, int time, IntType kind,
+		     unsigned int order);
 				// initialize an interrupt that will
 				// occur in the future
 
@@ -69,6 +73,41 @@ class PendingInterrupt {
     
     int when;			// When the interrupt is supposed to fire
     IntType type;		// for debugging
+    unsigned int seq;		// Order of scheduling, to break ties
+};
+
+// The following class defines the queue of interrupts scheduled to
+// occur, earliest first; interrupts due at the same time come out in
+// the order they were scheduled.
+//
+// It is a binary min-heap kept in an array of PendingInterrupts, so
+// scheduling and firing an interrupt are O(log n), and allocate nothing
+// unless the array has to grow.
+
+class PendingQueue {
+  public:
+    PendingQueue();		// initialize an empty queue
+    ~PendingQueue();		// de-allocate the queue
+
+    void Insert(CallBackObj *callOnInt, int when, IntType type);
+				// schedule an interrupt
+    bool IsEmpty() { return numPending == 0; }
+    PendingInterrupt *Front() { return &heap[0]; }
+				// the next interrupt to fire; valid
+				// until the queue is changed
+    PendingInterrupt RemoveFront();
+				// take the next interrupt off the queue
+
+    void Apply(void (*func)(PendingInterrupt *));
+				// call "func" on every interrupt, in the
+				// order they will fire (for debugging)
+
+  private:
+    PendingInterrupt *heap;	// heap[0] fires first; the children of
+				// heap[i] are heap[2i+1] and heap[2i+2]
+    int numPending;		// interrupts in the heap
+    int capacity;		// size of the heap array
+    unsigned int nextSeq;	// "seq" of the next interrupt scheduled
 };
 
 // The following class defines the data structures for the simulation
@@ -108,6 +147,10 @@ class Interrupt {
     int WriteFile(char *buffer, int size, OpenFileId fd);
     int CloseFile(OpenFileId fd);
     int ReadFile(char *buffer, int size, OpenFileId fd);
+    int PWriteFile(char *buffer, int size, int position, OpenFileId fd);
+    int PReadFile(char *buffer, int size, int position, OpenFileId fd);
+    int SeekFile(int position, OpenFileId fd);
+    int RemoveFile(char *filename);
  
     void YieldOnReturn();	// cause a context switch on return 
 				// from an interrupt handler
@@ -129,11 +172,15 @@ class Interrupt {
 				// at time "when".  This is called
     				// by the hardware device simulators.
     
-    void OneTick();       	// Advance simulated time
+    void OneTick(int count = 1);	// Advance simulated time by "count"
+				// ticks' worth of kernel or user code
+    int NextDue() { return nextDue; }
+				// When the next pending interrupt is
+				// due; far in the future if none is
 
   private:
     IntStatus level;		// are interrupts enabled or disabled?
-    SortedList<PendingInterrupt *> *pending;		
+    PendingQueue *pending;	
     				// the list of interrupts scheduled
 				// to occur in the future
     //int writeFileNo;            //UNIX file emulating the display
@@ -142,6 +189,11 @@ class Interrupt {
                                   //If so, you cannoot do another one
     bool yieldOnReturn; 	// TRUE if we are to context switch
 				// on return from the interrupt handler
+    int nextDue;		// "when" of the first pending interrupt,
+				// or NeverDue; so OneTick needn't look
+				// at the list until it is time
+    bool traceTicks;		// debugging interrupts: every tick
+				// has to take the slow path
     MachineStatus status;	// idle, kernel mode, user mode
 
     // these functions are internal to the interrupt simulation code
@@ -50,9 +50,14 @@ void CheckEndian()
 //
 //	"debug" -- if TRUE, drop into the debugger after each user instruction
 //		is executed.
+//	"blocks" -- if TRUE, run user programs a basic block at a time
+//		(see Machine::RunBlocks).
+//	"tlbEntries" -- the size of the TLB; if 0, there is no TLB, and
+//		a linear page table is used instead.
+//	"tlbAssoc" -- the number of entries in each set of the TLB.
 //----------------------------------------------------------------------
 
-Machine::Machine(bool debug)
+Machine::Machine(bool debug, bool blocks, int tlbEntries, int tlbAssoc)
 {
     int i;
 
@@ -61,17 +66,35 @@ Machine::Machine(bool debug)
     mainMemory = new char[MemorySize];
     for (i = 0; i < MemorySize; i++)
       	mainMemory[i] = 0;
-#ifdef USE_TLB
-    tlb = new TranslationEntry[TLBSize];
-    for (i = 0; i < TLBSize; i++)
-	tlb[i].valid = FALSE;
-    pageTable = NULL;
-#else	// use linear page table
-    tlb = NULL;
+    decoded = new Instruction[MemorySize / 4];
+    blockLength = new int[MemorySize / 4];
+    for (i = 0; i < MemorySize / 4; i++) {
+	decoded[i].opCode = 0;		// nothing decoded yet
+	blockLength[i] = 0;
+    }
+    codeFrame = new bool[NumPhysPages];
+    for (i = 0; i < NumPhysPages; i++)
+	codeFrame[i] = FALSE;
+    if (tlbEntries > 0) {
+	ASSERT(tlbAssoc > 0 && tlbEntries % tlbAssoc == 0);
+	tlb = new TranslationEntry[tlbEntries];
+	tlbLastUse = new int[tlbEntries];
+	for (i = 0; i < tlbEntries; i++) {
+	    tlb[i].valid = FALSE;
+	    tlbLastUse[i] = 0;
+	}
+    } else {			// use linear page table
+	tlb = NULL;
+	tlbLastUse = NULL;
+    }
+    tlbSize = tlbEntries;
+    tlbWays = tlbAssoc;
     pageTable = NULL;
-#endif
+    FlushHostCache();
 
     singleStep = debug;
+    runBlocks = blocks;
+    blockInstrs = 0;
     CheckEndian();
 }
 
@@ -83,8 +106,13 @@ Machine::Machine(bool debug)
 Machine::~Machine()
 {
     delete [] mainMemory;
-    if (tlb != NULL)
+    delete [] decoded;
+    delete [] blockLength;
+    delete [] codeFrame;
+    if (tlb != NULL) {
         delete [] tlb;
+        delete [] tlbLastUse;
+    }
 }
 
 //----------------------------------------------------------------------
@@ -103,6 +131,11 @@ Machine::RaiseException(ExceptionType which, int badVAddr)
     DEBUG(dbgMach, "Exception: " << exceptionNames[which]);
     registers[BadVAddrReg] = badVAddr;
     DelayedLoad(0, 0);			// finish anything in progress
+    if (blockInstrs > 0) {		// the basic block interpreter hasn't
+	kernel->stats->totalTicks += blockInstrs * UserTick;
+	kernel->stats->userTicks += blockInstrs * UserTick;
+	blockInstrs = 0;		// charged for the instructions before
+    }					// this one yet
     kernel->interrupt->setStatus(SystemMode);
     ExceptionHandler(which);		// interrupts are enabled at this point
     kernel->interrupt->setStatus(UserMode);
@@ -39,6 +39,9 @@ const int NumPhysPages = 128;
 
 const int MemorySize = (NumPhysPages * PageSize);
 const int TLBSize = 4;			// if there is a TLB, make it small
+					// (the default size; see -tlb)
+const int HostCacheSize = 64;		// pages in the host translation
+					// cache; must be a power of 2
 
 enum ExceptionType { NoException,           // Everything ok!
 		     SyscallException,      // A program executed a system call.
@@ -75,6 +78,47 @@ enum ExceptionType { NoException,           // Everything ok!
 
 #define NumTotalRegs 	40
 
+// The following class defines an instruction, represented in both
+// 	undecoded binary form
+//      decoded to identify
+//	    operation to do
+//	    registers to act on
+//	    any immediate operand value
+//
+// The machine keeps one for each word of main memory, decoded the first
+// time the word is executed (see mipssim.cc); an opCode of 0 means the
+// word hasn't been decoded since it was last written.
+
+class Instruction {
+  public:
+    void Decode();	// decode the binary representation of the instruction
+
+    unsigned int value; // binary representation of the instruction
+
+    char opCode;     // Type of instruction.  This is NOT the same as the
+    		     // opcode field from the instruction: see defs in mips.h
+    char rs, rt, rd; // Three registers from instruction.
+    int extra;       // Immediate or target or shamt field or offset.
+                     // Immediates are sign-extended.
+};
+
+// The following class defines an entry in the host translation cache,
+// a small direct-mapped cache, kept by the simulator rather than the
+// simulated hardware, of the virtual pages ReadMem and WriteMem have
+// translated lately.  A hit skips Translate: the use and dirty bits
+// are set directly in the page table or TLB entry the page came from,
+// and the read-only bit is checked there, so they stay as Translate
+// would leave them.
+
+class HostTranslation {
+  public:
+    int vpn;			// the virtual page, or -1 if the entry
+				// is empty
+    int frame;			// the physical page it is in
+    TranslationEntry *entry;	// the page table or TLB entry for it
+    int tlbIndex;		// which TLB entry that is, or -1
+};
+
 // The following class defines the simulated host workstation hardware, as 
 // seen by user programs -- the CPU registers, main memory, etc.
 // User programs shouldn't be able to tell that they are running on our 
@@ -88,13 +132,15 @@ enum ExceptionType { NoException,           // Everything ok!
 // The procedures in this class are defined in machine.cc, mipssim.cc, and
 // translate.cc.
 
-class Instruction;
 class Interrupt;
 
 class Machine {
   public:
-    Machine(bool debug);	// Initialize the simulation of the hardware
-				// for running user programs
+    Machine(bool debug, bool blocks, int tlbEntries, int tlbAssoc);
+				// Initialize the simulation of the hardware
+				// for running user programs; "blocks" picks
+				// the basic block interpreter, and
+				// "tlbEntries" the size of the TLB, if any
     ~Machine();			// De-allocate the data structures
 
 // Routines callable by the Nachos kernel
@@ -125,6 +171,10 @@ class Machine {
 // If "tlb" is non-NULL, the Nachos kernel is responsible for managing
 //	the contents of the TLB.  But the kernel can use any data structure
 //	it wants (eg, segmented paging) for handling TLB cache misses.
+//
+// The TLB has "tlbSize" entries, in sets of "tlbWays": a virtual page
+// can only be in the set TlbSet() maps it to.  "tlbWays" == "tlbSize"
+// makes the TLB fully associative.
 // 
 // For simplicity, both the page table pointer and the TLB pointer are
 // public.  However, while there can be multiple page tables (one per address
@@ -134,6 +184,12 @@ class Machine {
 
     TranslationEntry *tlb;		// this pointer should be considered 
 					// "read-only" to Nachos kernel code
+    int tlbSize;			// entries in the TLB, 0 if none
+    int tlbWays;			// entries in each set of the TLB
+    int *tlbLastUse;			// for each TLB entry, when it was
+					// last used, counted in TLB hits
+    int TlbSet(int vpn) { return (vpn % (tlbSize / tlbWays)) * tlbWays; }
+					// first entry of the set "vpn" maps to
 
     TranslationEntry *pageTable;
     unsigned int pageTableSize;
@@ -143,14 +199,42 @@ class Machine {
     				// Read or write 1, 2, or 4 bytes of virtual 
 				// memory (at addr).  Return FALSE if a 
 				// correct translation couldn't be found.
+
+    void InvalidateCode(int frame);
+				// The contents of "frame" have changed;
+				// forget any instructions decoded from it.
+				// The kernel must call this whenever it
+				// writes into mainMemory itself.
+
+    void FlushHostCache();	// Forget every cached translation; the
+				// kernel must call this when it switches
+				// page tables or empties the TLB
+    void InvalidateHostPage(int vpn);
+				// Forget the cached translation of "vpn";
+				// the kernel must call this before it
+				// changes or drops the page table or TLB
+				// entry for "vpn"
   private:
 
 // Routines internal to the machine simulation -- DO NOT call these directly
     void DelayedLoad(int nextReg, int nextVal);  	
 				// Do a pending delayed load (modifying a reg)
 
-    void OneInstruction(Instruction *instr); 	
-    				// Run one instruction of a user program.
+    void OneInstruction(); 	// Run one instruction of a user program.
+    bool Execute(Instruction *instr);
+				// Execute a decoded instruction; FALSE if
+				// it raised an exception
+    void RunBlocks();		// Run a user program a basic block at
+				// a time; never returns
+
+    Instruction *Fetch(int pc);	// Translate "pc" and return the decoded
+				// instruction there, decoding it if need
+				// be; NULL if an exception was raised
+    Instruction *FetchBlock(int pc, int *length);
+				// Likewise, but return the basic block
+				// starting at "pc", and its length
+    Instruction *Decoded(int physAddr);
+				// The decoded instruction at "physAddr"
     
 
 
@@ -160,6 +244,14 @@ class Machine {
 				// the translation entry appropriately,
     				// and return an exception code if the 
 				// translation couldn't be completed.
+    bool CachedTranslate(int virtAddr, int* physAddr, int size, bool writing);
+				// Likewise, through the host translation
+				// cache; FALSE if the page isn't cached
+				// (or the access would fail), in which
+				// case Translate has to be called
+    void CacheTranslation(int virtAddr);
+				// Cache the translation of "virtAddr",
+				// which Translate just succeeded on
 
     void RaiseException(ExceptionType which, int badVAddr);
 				// Trap to the Nachos kernel, because of a
@@ -173,6 +265,20 @@ class Machine {
 
     int registers[NumTotalRegs]; // CPU registers, for executing user programs
 
+    Instruction *decoded;	// decoded instruction for each word of
+				// main memory, by physical address
+    int *blockLength;		// for each word of main memory, the
+				// length of the basic block starting
+				// there, or 0 if none has been formed
+    bool *codeFrame;		// for each frame, whether any of its
+				// words are in "decoded"
+    HostTranslation hostCache[HostCacheSize];
+				// recent translations, by virtual page
+				// number modulo HostCacheSize
+    bool runBlocks;		// use the basic block interpreter
+    int blockInstrs;		// instructions of the current basic block
+				// run so far but not yet charged for
+
     bool singleStep;		// drop back into the debugger after each
 				// simulated instruction
     int runUntilTime;		// drop back into the debugger when simulated
@@ -24,26 +24,6 @@
 
 static void Mult(int a, int b, bool signedArith, int* hiPtr, int* loPtr);
 
-// The following class defines an instruction, represented in both
-// 	undecoded binary form
-//      decoded to identify
-//	    operation to do
-//	    registers to act on
-//	    any immediate operand value
-
-class Instruction {
-  public:
-    void Decode();	// decode the binary representation of the instruction
-
-    unsigned int value; // binary representation of the instruction
-
-    char opCode;     // Type of instruction.  This is NOT the same as the
-    		     // opcode field from the instruction: see defs in mips.h
-    char rs, rt, rd; // Three registers from instruction.
-    int extra;       // Immediate or target or shamt field or offset.
-                     // Immediates are sign-extended.
-};
-
 //----------------------------------------------------------------------
 // Machine::Run
 // 	Simulate the execution of a user-level program on Nachos.
@@ -56,15 +36,15 @@ class Instruction {
 void
 Machine::Run()
 {
-    Instruction *instr = new Instruction;  // storage for decoded instruction
-
     if (debug->IsEnabled('m')) {
         cout << "Starting program in thread: " << kernel->currentThread->getName();
 		cout << ", at time: " << kernel->stats->totalTicks << "\n";
     }
     kernel->interrupt->setStatus(UserMode);
+    if (runBlocks && !singleStep && !debug->IsEnabled('m'))
+	RunBlocks();			// never returns
     for (;;) {
-        OneInstruction(instr);
+        OneInstruction();
 		kernel->interrupt->OneTick();
 		if (singleStep && (runUntilTime <= kernel->stats->totalTicks))
 	  		Debugger();
@@ -72,6 +52,114 @@ Machine::Run()
 }
 
 
+//----------------------------------------------------------------------
+// Machine::RunBlocks
+// 	Simulate the execution of a user-level program a basic block at
+//	a time.  The instructions of a block have already been translated
+//	and decoded, and are run back to back; simulated time is advanced,
+//	and interrupts checked for, once per block rather than once per
+//	instruction.
+//
+//	The result is the same as running OneInstruction in a loop:
+//	  - a block is cut short so it ends exactly when the next pending
+//	    interrupt is due, so interrupts fire after the same instruction
+//	  - an exception part way through first charges for the
+//	    instructions before it (see RaiseException), so the kernel
+//	    sees the same time
+//	  - once the PC doesn't follow on (a branch was taken, or an
+//	    exception changed it), the rest of the block is skipped
+//
+//	Blocks, like decoded instructions, are kept by physical address
+//	and thrown away when their frame is written.
+//----------------------------------------------------------------------
+
+void
+Machine::RunBlocks()
+{
+    Interrupt *interrupt = kernel->interrupt;
+    Instruction *block;
+    int pc, length, due, count;
+    bool ok;
+
+    for (;;) {
+	pc = registers[PCReg];
+	block = FetchBlock(pc, &length);
+	if (block == NULL) {		// exception on the fetch
+	    interrupt->OneTick();
+	    continue;
+	}
+	due = interrupt->NextDue();
+	if (length > (due - kernel->stats->totalTicks) / UserTick)
+	    length = max((due - kernel->stats->totalTicks) / UserTick, 1);
+
+	ok = TRUE;
+	for (int i = 0; i < length; i++) {
+	    if (block[i].opCode == 0)	// the block stored into its own frame
+		break;
+	    if (!Execute(&block[i])) {
+		ok = FALSE;
+		break;
+	    }
+	    blockInstrs++;
+	    if (registers[PCReg] != pc + 4 * (i + 1))
+		break;			// not falling through any more
+	}
+	count = blockInstrs + (ok ? 0 : 1);
+	blockInstrs = 0;		// before OneTick, which may switch
+	interrupt->OneTick(count);	// threads
+    }
+}
+
+//----------------------------------------------------------------------
+// EndsBlock
+// 	Return TRUE if a basic block ends after an instruction with
+//	opcode "opCode", FALSE if it goes on.  "inDelaySlot" says whether
+//	the instruction is in the delay slot of a branch or jump.
+//----------------------------------------------------------------------
+
+static bool
+EndsBlock(int opCode, bool inDelaySlot)
+{
+    if (inDelaySlot)
+	return TRUE;
+    switch (opCode) {
+      case OP_SYSCALL:
+      case OP_RES:
+      case OP_UNIMP:
+	return TRUE;
+      default:
+	return FALSE;
+    }
+}
+
+//----------------------------------------------------------------------
+// HasDelaySlot
+// 	Return TRUE if an instruction with opcode "opCode" is a branch
+//	or jump, and so is followed by a delay slot.
+//----------------------------------------------------------------------
+
+static bool
+HasDelaySlot(int opCode)
+{
+    switch (opCode) {
+      case OP_BEQ:
+      case OP_BNE:
+      case OP_BGEZ:
+      case OP_BGEZAL:
+      case OP_BGTZ:
+      case OP_BLEZ:
+      case OP_BLTZ:
+      case OP_BLTZAL:
+      case OP_J:
+      case OP_JAL:
+      case OP_JALR:
+      case OP_JR:
+	return TRUE;
+      default:
+	return FALSE;
+    }
+}
+
 //----------------------------------------------------------------------
 // TypeToReg
 // 	Retrieve the register # referred to in an instruction. 
@@ -114,27 +202,47 @@ TypeToReg(RegType reg, Instruction *instr)
 //	store all data back to the machine registers and memory before
 //	leaving.  This allows the Nachos kernel to control our behavior
 //	by controlling the contents of memory, the translation table,
-//	and the register set.
+//	and the register set.  The one exception is the decoded form of
+//	each instruction, which is kept by physical address and thrown
+//	away whenever its frame is written (see InvalidateCode).
 //----------------------------------------------------------------------
 
 void
-Machine::OneInstruction(Instruction *instr)
+Machine::OneInstruction()
+{
+    Instruction *instr;
+
+    // Fetch instruction, already decoded unless this is the first time
+    // it has been executed since its frame was written
+    instr = Fetch(registers[PCReg]);
+    if (instr == NULL)
+	return;			// exception occurred
+    (void) Execute(instr);
+}
+
+//----------------------------------------------------------------------
+// Machine::Execute
+// 	Execute one decoded instruction, the one at registers[PCReg].
+//	Both OneInstruction and the basic block interpreter (RunBlocks)
+//	come here, so there is only one definition of what each
+//	instruction does.
+//
+//	Returns FALSE if the instruction raised an exception.
+//
+//	"instr" -- the decoded instruction
+//----------------------------------------------------------------------
+
+bool
+Machine::Execute(Instruction *instr)
 {
 #ifdef SIM_FIX
     int byte;       // described in Kane for LWL,LWR,...
 #endif
 
-    int raw;
     int nextLoadReg = 0; 	
     int nextLoadValue = 0; 	// record delayed load operation, to apply
 				// in the future
 
-    // Fetch instruction 
-    if (!ReadMem(registers[PCReg], 4, &raw))
-	return;			// exception occurred
-    instr->value = raw;
-    instr->Decode();
-
     if (debug->IsEnabled('m')) {
         struct OpString *str = &opStrings[instr->opCode];
 	char buf[80];
@@ -159,7 +267,7 @@ Machine::OneInstruction(Instruction *instr)
 	if (!((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
 	    ((registers[instr->rs] ^ sum) & SIGN_BIT)) {
 	    RaiseException(OverflowException, 0);
-	    return;
+	    return FALSE;
 	}
 	registers[instr->rd] = sum;
 	break;
@@ -169,7 +277,7 @@ Machine::OneInstruction(Instruction *instr)
 	if (!((registers[instr->rs] ^ instr->extra) & SIGN_BIT) &&
 	    ((instr->extra ^ sum) & SIGN_BIT)) {
 	    RaiseException(OverflowException, 0);
-	    return;
+	    return FALSE;
 	}
 	registers[instr->rt] = sum;
 	break;
@@ -264,7 +372,7 @@ Machine::OneInstruction(Instruction *instr)
       case OP_LBU:
 	tmp = registers[instr->rs] + instr->extra;
 	if (!ReadMem(tmp, 1, &value))
-	    return;
+	    return FALSE;
 
 	if ((value & 0x80) && (instr->opCode == OP_LB))
 	    value |= 0xffffff00;
@@ -279,10 +387,10 @@ Machine::OneInstruction(Instruction *instr)
 	tmp = registers[instr->rs] + instr->extra;
 	if (tmp & 0x1) {
 	    RaiseException(AddressErrorException, tmp);
-	    return;
+	    return FALSE;
 	}
 	if (!ReadMem(tmp, 2, &value))
-	    return;
+	    return FALSE;
 
 	if ((value & 0x8000) && (instr->opCode == OP_LH))
 	    value |= 0xffff0000;
@@ -301,10 +409,10 @@ Machine::OneInstruction(Instruction *instr)
 	tmp = registers[instr->rs] + instr->extra;
 	if (tmp & 0x3) {
 	    RaiseException(AddressErrorException, tmp);
-	    return;
+	    return FALSE;
 	}
 	if (!ReadMem(tmp, 4, &value))
-	    return;
+	    return FALSE;
 	nextLoadReg = instr->rt;
 	nextLoadValue = value;
 	break;
@@ -324,7 +432,7 @@ Machine::OneInstruction(Instruction *instr)
         // DEBUG('P', "Addr 0x%X\n",tmp-byte);
 
         if (!ReadMem(tmp-byte, 4, &value))
-            return;
+            return FALSE;
 #else
 	// ReadMem assumes all 4 byte requests are aligned on an even 
 	// word boundary.  Also, the little endian/big endian swap code would
@@ -332,7 +440,7 @@ Machine::OneInstruction(Instruction *instr)
 	ASSERT((tmp & 0x3) == 0);  
 
 	if (!ReadMem(tmp, 4, &value))
-	    return;
+	    return FALSE;
 #endif
 
 	if (registers[LoadReg] == instr->rt)
@@ -376,7 +484,7 @@ Machine::OneInstruction(Instruction *instr)
         // DEBUG('P', "Addr 0x%X\n",tmp-byte);
 
         if (!ReadMem(tmp-byte, 4, &value))
-            return;
+            return FALSE;
 #else
 	// ReadMem assumes all 4 byte requests are aligned on an even 
 	// word boundary.  Also, the little endian/big endian swap code would
@@ -384,7 +492,7 @@ Machine::OneInstruction(Instruction *instr)
 	ASSERT((tmp & 0x3) == 0);  
 
 	if (!ReadMem(tmp, 4, &value))
-	    return;
+	    return FALSE;
 #endif
 
 	if (registers[LoadReg] == instr->rt)
@@ -458,13 +566,13 @@ Machine::OneInstruction(Instruction *instr)
       case OP_SB:
 	if (!WriteMem((unsigned) 
 		(registers[instr->rs] + instr->extra), 1, registers[instr->rt]))
-	    return;
+	    return FALSE;
 	break;
 	
       case OP_SH:
 	if (!WriteMem((unsigned) 
 		(registers[instr->rs] + instr->extra), 2, registers[instr->rt]))
-	    return;
+	    return FALSE;
 	break;
 	
       case OP_SLL:
@@ -534,7 +642,7 @@ Machine::OneInstruction(Instruction *instr)
 	if (((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
 	    ((registers[instr->rs] ^ diff) & SIGN_BIT)) {
 	    RaiseException(OverflowException, 0);
-	    return;
+	    return FALSE;
 	}
 	registers[instr->rd] = diff;
 	break;
@@ -546,7 +654,7 @@ Machine::OneInstruction(Instruction *instr)
       case OP_SW:
 	if (!WriteMem((unsigned) 
 		(registers[instr->rs] + instr->extra), 4, registers[instr->rt]))
-	    return;
+	    return FALSE;
 	break;
 	
       case OP_SWL:	  
@@ -562,7 +670,7 @@ Machine::OneInstruction(Instruction *instr)
         byte = tmp & 0x3;
         // DEBUG('P', "Addr 0x%X\n",tmp-byte);
         if (!ReadMem(tmp-byte, 4, &value))
-            return;
+            return FALSE;
 
         // DEBUG('P', "Value 0x%X\n",value);
 #else
@@ -572,7 +680,7 @@ Machine::OneInstruction(Instruction *instr)
 	ASSERT((tmp & 0x3) == 0);  
 
 	if (!ReadMem((tmp & ~0x3), 4, &value))
-	    return;
+	    return FALSE;
 #endif
 
 #ifdef SIM_FIX
@@ -599,12 +707,12 @@ Machine::OneInstruction(Instruction *instr)
 	}
 #ifndef SIM_FIX
         if (!WriteMem((tmp & ~0x3), 4, value))
-            return;
+            return FALSE;
 #else
         // DEBUG('P', "Value 0x%X\n",value);
 
         if (!WriteMem((tmp - byte), 4, value))
-            return;
+            return FALSE;
 #endif // SIM_FIX
 	break;
     	
@@ -617,7 +725,7 @@ Machine::OneInstruction(Instruction *instr)
         ASSERT((tmp & 0x3) == 0);  
 
         if (!ReadMem((tmp & ~0x3), 4, &value))
-            return;
+            return FALSE;
 #else
         // The only difference between this code and the BIG ENDIAN code
         // is that the ReadMem call is guaranteed an aligned access as 
@@ -630,7 +738,7 @@ Machine::OneInstruction(Instruction *instr)
         // DEBUG('P', "Addr 0x%X\n",tmp-byte);
 
         if (!ReadMem(tmp-byte, 4, &value))
-            return;
+            return FALSE;
         // DEBUG('P', "Value 0x%X\n",value);
 #endif // SIM_FIX
 
@@ -656,12 +764,12 @@ Machine::OneInstruction(Instruction *instr)
 
 #ifndef SIM_FIX
         if (!WriteMem((tmp & ~0x3), 4, value))
-            return;
+            return FALSE;
 #else
         // DEBUG('P', "Value 0x%X\n",value);
 
         if (!WriteMem((tmp - byte), 4, value))
-            return;
+            return FALSE;
 #endif // SIM_FIX
 
 
@@ -669,7 +777,7 @@ Machine::OneInstruction(Instruction *instr)
     	
       case OP_SYSCALL:
 	RaiseException(SyscallException, 0);
-	return; 
+	return FALSE; 
 	
       case OP_XOR:
 	registers[instr->rd] = registers[instr->rs] ^ registers[instr->rt];
@@ -682,7 +790,7 @@ Machine::OneInstruction(Instruction *instr)
       case OP_RES:
       case OP_UNIMP:
 	RaiseException(IllegalInstrException, 0);
-	return;
+	return FALSE;
 	
       default:
 	ASSERT(FALSE);
@@ -698,6 +806,7 @@ Machine::OneInstruction(Instruction *instr)
 						// are jumping into lala-land
     registers[PCReg] = registers[NextPCReg];
     registers[NextPCReg] = pcAfter;
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
@@ -717,6 +826,117 @@ Machine::DelayedLoad(int nextReg, int nextValue)
     registers[0] = 0; 	// and always make sure R0 stays zero.
 }
 
+//----------------------------------------------------------------------
+// Machine::Fetch
+// 	Translate the program counter "pc" and return the instruction
+//	there, in decoded form.  The decoded instruction is looked up by
+//	physical address, so a hot loop is fetched from memory and decoded
+//	only once, by whichever program ran it first in that frame.
+//
+//	Returns NULL, having raised the exception, if "pc" can't be
+//	translated.
+//----------------------------------------------------------------------
+
+Instruction *
+Machine::Fetch(int pc)
+{
+    ExceptionType exception;
+    int physAddr;
+
+    exception = Translate(pc, &physAddr, 4, FALSE);
+    if (exception != NoException) {
+	RaiseException(exception, pc);
+	return NULL;
+    }
+    return Decoded(physAddr);
+}
+
+//----------------------------------------------------------------------
+// Machine::FetchBlock
+// 	Translate the program counter "pc" and return the basic block
+//	starting there: the decoded instructions up to and including the
+//	delay slot of the first branch or jump, or a syscall.  A block
+//	never crosses into the next frame, so one translation covers it.
+//	The block is formed the first time it is run, and remembered.
+//
+//	Returns NULL, having raised the exception, if "pc" can't be
+//	translated.
+//
+//	"pc" -- the virtual address of the first instruction
+//	"length" -- where to put the number of instructions in the block
+//----------------------------------------------------------------------
+
+Instruction *
+Machine::FetchBlock(int pc, int *length)
+{
+    ExceptionType exception;
+    int physAddr, addr, frameEnd;
+    bool inDelaySlot = FALSE;
+    Instruction *instr;
+
+    exception = Translate(pc, &physAddr, 4, FALSE);
+    if (exception != NoException) {
+	RaiseException(exception, pc);
+	return NULL;
+    }
+    if (blockLength[physAddr / 4] == 0) {
+	frameEnd = (physAddr / PageSize + 1) * PageSize;
+	for (addr = physAddr; addr < frameEnd; addr += 4) {
+	    instr = Decoded(addr);
+	    if (EndsBlock(instr->opCode, inDelaySlot))
+		break;
+	    inDelaySlot = HasDelaySlot(instr->opCode);
+	}
+	blockLength[physAddr / 4] = (min(addr + 4, frameEnd) - physAddr) / 4;
+    }
+    *length = blockLength[physAddr / 4];
+    return &decoded[physAddr / 4];
+}
+
+//----------------------------------------------------------------------
+// Machine::Decoded
+// 	Return the instruction at physical address "physAddr", decoding
+//	it if it hasn't been since its frame was last written.
+//----------------------------------------------------------------------
+
+Instruction *
+Machine::Decoded(int physAddr)
+{
+    Instruction *instr = &decoded[physAddr / 4];
+
+    if (instr->opCode == 0) {		// not decoded yet
+	instr->value = WordToHost(*(unsigned int *) &mainMemory[physAddr]);
+	instr->Decode();
+	codeFrame[physAddr / PageSize] = TRUE;
+    }
+    return instr;
+}
+
+//----------------------------------------------------------------------
+// Machine::InvalidateCode
+// 	Forget every decoded instruction in "frame", because its contents
+//	have changed -- the user program stored into it, or the kernel
+//	paged something else in.  Frames nothing was decoded from are
+//	left alone, so an ordinary store costs one test.
+//
+//	"frame" -- the physical page that was written
+//----------------------------------------------------------------------
+
+void
+Machine::InvalidateCode(int frame)
+{
+    Instruction *instr;
+
+    if (!codeFrame[frame])
+	return;
+    instr = &decoded[frame * (PageSize / 4)];
+    for (int i = 0; i < PageSize / 4; i++) {
+	instr[i].opCode = 0;
+	blockLength[frame * (PageSize / 4) + i] = 0;
+    }
+    codeFrame[frame] = FALSE;
+}
+
 //----------------------------------------------------------------------
 // Instruction::Decode
 // 	Decode a MIPS instruction 
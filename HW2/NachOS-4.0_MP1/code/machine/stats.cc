@@ -22,6 +22,57 @@ Statistics::Statistics()
     numDiskReads = numDiskWrites = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numEvictions = numSwapIns = numSwapOuts = 0;
+    numTlbHits = numTlbMisses = numTlbRefills = 0;
+    for (int i = 0; i < NumSyscallCodes; i++) {
+	syscalls[i].name = NULL;
+	syscalls[i].count = syscalls[i].ticks = 0;
+	syscalls[i].hostNs = 0;
+	for (int b = 0; b < NumHistBuckets; b++)
+	    syscalls[i].tickHist[b] = syscalls[i].hostNsHist[b] = 0;
+    }
+}
+
+//----------------------------------------------------------------------
+// HistBucket
+// 	Return the histogram bucket for "value": 0 for zero, otherwise
+//	one more than the position of its highest set bit.
+//----------------------------------------------------------------------
+
+static int
+HistBucket(long long value)
+{
+    int bucket = 0;
+
+    while (value > 0 && bucket < NumHistBuckets - 1) {
+	value >>= 1;
+	bucket++;
+    }
+    return bucket;
+}
+
+//----------------------------------------------------------------------
+// Statistics::RecordSyscall
+// 	Account for one system call, which took "ticks" of simulated time
+//	and "hostNs" nanoseconds of host time.
+//
+//	"code" -- the system call code (SC_*)
+//	"name" -- its name, for Print
+//----------------------------------------------------------------------
+
+void
+Statistics::RecordSyscall(int code, const char *name, int ticks,
+			  long long hostNs)
+{
+    ASSERT(code >= 0 && code < NumSyscallCodes);
+    SyscallStats *s = &syscalls[code];
+
+    s->name = name;
+    s->count++;
+    s->ticks += ticks;
+    s->hostNs += hostNs;
+    s->tickHist[HistBucket(ticks)]++;
+    s->hostNsHist[HistBucket(hostNs)]++;
 }
 
 //----------------------------------------------------------------------
@@ -39,7 +90,71 @@ Statistics::Print()
 		cout << ", writes " << numDiskWrites << "\n";
 		cout << "Console I/O: reads " << numConsoleCharsRead;
     cout << ", writes " << numConsoleCharsWritten << "\n";
-    cout << "Paging: faults " << numPageFaults << "\n";
+    cout << "Paging: faults " << numPageFaults << ", evictions ";
+    cout << numEvictions << ", swap ins " << numSwapIns;
+    cout << ", swap outs " << numSwapOuts << "\n";
+    if (numTlbHits + numTlbMisses > 0) {	// only if there is a TLB
+	cout << "TLB: hits " << numTlbHits << ", misses " << numTlbMisses;
+	cout << ", refills " << numTlbRefills << "\n";
+    }
     cout << "Network I/O: packets received " << numPacketsRecvd;
 		cout << ", sent " << numPacketsSent << "\n";
+    PrintSyscalls();
+}
+
+//----------------------------------------------------------------------
+// Statistics::PrintSyscalls
+// 	Print, for every system call that was made, how many times it
+//	was called, the time spent in it, and the histograms of how long
+//	each call took.  A histogram line "<2^b: n" means n calls took
+//	less than 2^b (and at least 2^(b-1)).
+//----------------------------------------------------------------------
+
+void
+Statistics::PrintSyscalls()
+{
+    for (int i = 0; i < NumSyscallCodes; i++) {
+	SyscallStats *s = &syscalls[i];
+	if (s->count == 0)
+	    continue;
+	cout << "Syscall " << s->name << ": calls " << s->count;
+	cout << ", ticks " << s->ticks << " (avg " << s->ticks / s->count << ")";
+	cout << ", host ns " << s->hostNs << " (avg " << s->hostNs / s->count << ")\n";
+	cout << "    ticks:";
+	for (int b = 0; b < NumHistBuckets; b++)
+	    if (s->tickHist[b] != 0)
+		cout << " <2^" << b << ": " << s->tickHist[b];
+	cout << "\n    host ns:";
+	for (int b = 0; b < NumHistBuckets; b++)
+	    if (s->hostNsHist[b] != 0)
+		cout << " <2^" << b << ": " << s->hostNsHist[b];
+	cout << "\n";
+    }
+}
+
+//----------------------------------------------------------------------
+// Statistics::PrintSyscallsMachine
+// 	Print the same information as PrintSyscalls, as comma-separated
+//	lines meant for scripts:
+//
+//	   syscall,<name>,<calls>,<ticks>,<host ns>
+//	   hist,<name>,ticks|hostns,<bucket>,<calls>
+//----------------------------------------------------------------------
+
+void
+Statistics::PrintSyscallsMachine()
+{
+    for (int i = 0; i < NumSyscallCodes; i++) {
+	SyscallStats *s = &syscalls[i];
+	if (s->count == 0)
+	    continue;
+	cout << "syscall," << s->name << "," << s->count << ",";
+	cout << s->ticks << "," << s->hostNs << "\n";
+	for (int b = 0; b < NumHistBuckets; b++)
+	    if (s->tickHist[b] != 0)
+		cout << "hist," << s->name << ",ticks," << b << "," << s->tickHist[b] << "\n";
+	for (int b = 0; b < NumHistBuckets; b++)
+	    if (s->hostNsHist[b] != 0)
+		cout << "hist," << s->name << ",hostns," << b << "," << s->hostNsHist[b] << "\n";
+    }
 }
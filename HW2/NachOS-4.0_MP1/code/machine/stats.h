@@ -13,6 +13,28 @@
 
 #include "copyright.h"
 
+const int NumSyscallCodes = 128;	// system call codes (SC_*) are
+					// all below this
+const int NumHistBuckets = 40;		// log2 histogram buckets; bucket b
+					// counts values in [2^(b-1), 2^b),
+					// bucket 0 counts zeroes
+
+// Per-system-call statistics, kept by the system call dispatcher in
+// userprog/exception.cc.  Besides the totals, the time each call took
+// is kept as a histogram, both in simulated ticks and in host time,
+// so that a few slow calls can be told apart from many cheap ones.
+
+class SyscallStats {
+  public:
+    const char *name;		// name of the system call, NULL if it
+				// was never made
+    int count;			// number of calls
+    int ticks;			// simulated time spent in them, in total
+    long long hostNs;		// host time spent in them, in total
+    int tickHist[NumHistBuckets];	// calls, by simulated time taken
+    int hostNsHist[NumHistBuckets];	// calls, by host time taken
+};
+
 // The following class defines the statistics that are to be kept
 // about Nachos behavior -- how much time (ticks) elapsed, how
 // many user instructions executed, etc.
@@ -33,11 +55,26 @@ class Statistics {
     int numConsoleCharsRead;	// number of characters read from the keyboard
     int numConsoleCharsWritten; // number of characters written to the display
     int numPageFaults;		// number of virtual memory page faults
+    int numEvictions;		// number of pages evicted from memory
+    int numSwapIns;		// number of pages read back from swap
+    int numSwapOuts;		// number of pages written to swap
+    int numTlbHits;		// number of translations found in the TLB
+    int numTlbMisses;		// number of translations not in the TLB
+    int numTlbRefills;		// number of TLB entries loaded by the kernel
     int numPacketsSent;		// number of packets sent over the network
     int numPacketsRecvd;	// number of packets received over the network
+    SyscallStats syscalls[NumSyscallCodes];
+				// calls and time, by system call code
 
     Statistics(); 		// initialize everything to zero
 
+    void RecordSyscall(int code, const char *name, int ticks,
+		       long long hostNs);
+				// account for one system call
+    void PrintSyscalls();	// print the system call table, for
+				// people to read
+    void PrintSyscallsMachine(); // and in a form easy to parse
+
     void Print();		// print collected statistics
 };
 
@@ -91,10 +91,13 @@ Machine::ReadMem(int addr, int size, int *value)
     
     DEBUG(dbgAddr, "Reading VA " << addr << ", size " << size);
     
-    exception = Translate(addr, &physicalAddress, size, FALSE);
-    if (exception != NoException) {
-	RaiseException(exception, addr);
-	return FALSE;
+    if (!CachedTranslate(addr, &physicalAddress, size, FALSE)) {
+	exception = Translate(addr, &physicalAddress, size, FALSE);
+	if (exception != NoException) {
+	    RaiseException(exception, addr);
+	    return FALSE;
+	}
+	CacheTranslation(addr);
     }
     switch (size) {
       case 1:
@@ -140,11 +143,15 @@ Machine::WriteMem(int addr, int size, int value)
      
     DEBUG(dbgAddr, "Writing VA " << addr << ", size " << size << ", value " << value);
 
-    exception = Translate(addr, &physicalAddress, size, TRUE);
-    if (exception != NoException) {
-	RaiseException(exception, addr);
-	return FALSE;
+    if (!CachedTranslate(addr, &physicalAddress, size, TRUE)) {
+	exception = Translate(addr, &physicalAddress, size, TRUE);
+	if (exception != NoException) {
+	    RaiseException(exception, addr);
+	    return FALSE;
+	}
+	CacheTranslation(addr);
     }
+    InvalidateCode(physicalAddress / PageSize);	// self-modifying code
     switch (size) {
       case 1:
 	mainMemory[physicalAddress] = (unsigned char) (value & 0xff);
@@ -184,7 +191,7 @@ Machine::WriteMem(int addr, int size, int value)
 ExceptionType
 Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 {
-    int i;
+    int i, set;
     unsigned int vpn, offset;
     TranslationEntry *entry;
     unsigned int pageFrame;
@@ -214,13 +221,16 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 	    return PageFaultException;
 	}
 	entry = &pageTable[vpn];
-    } else {
-        for (entry = NULL, i = 0; i < TLBSize; i++)
+    } else {			// => TLB => look in the set vpn maps to
+	set = TlbSet(vpn);
+        for (entry = NULL, i = set; i < set + tlbWays; i++)
     	    if (tlb[i].valid && (tlb[i].virtualPage == ((int)vpn))) {
 		entry = &tlb[i];			// FOUND!
+		tlbLastUse[i] = ++kernel->stats->numTlbHits;
 		break;
 	    }
 	if (entry == NULL) {				// not found
+	    kernel->stats->numTlbMisses++;
     	    DEBUG(dbgAddr, "Invalid TLB entry for this virtual page!");
     	    return PageFaultException;		// really, this is a TLB fault,
 						// the page may be in memory,
@@ -248,3 +258,102 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
     DEBUG(dbgAddr, "phys addr = " << *physAddr);
     return NoException;
 }
+
+//----------------------------------------------------------------------
+// Machine::CachedTranslate
+// 	Translate a virtual address the way Translate would, but using
+//	the host translation cache.  Return FALSE if the page isn't in
+//	the cache, or if Translate is needed anyway -- the address is
+//	unaligned, or the page is read-only and this is a write -- so
+//	that Translate can raise the exception.
+//
+//	"virtAddr" -- the virtual address to translate
+//	"physAddr" -- the place to store the physical address
+//	"size" -- the amount of memory being read or written
+// 	"writing" -- if TRUE, the page must not be read-only
+//----------------------------------------------------------------------
+
+bool
+Machine::CachedTranslate(int virtAddr, int* physAddr, int size, bool writing)
+{
+    unsigned int vpn = (unsigned) virtAddr / PageSize;
+    HostTranslation *cached = &hostCache[vpn % HostCacheSize];
+
+    if (cached->vpn != (int) vpn || (virtAddr & (size - 1)) != 0)
+	return FALSE;
+    if (writing) {
+	if (cached->entry->readOnly)
+	    return FALSE;
+	cached->entry->dirty = TRUE;
+    }
+    cached->entry->use = TRUE;
+    if (cached->tlbIndex != -1)		// it was a TLB hit all the same
+	tlbLastUse[cached->tlbIndex] = ++kernel->stats->numTlbHits;
+    *physAddr = cached->frame * PageSize + (unsigned) virtAddr % PageSize;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Machine::CacheTranslation
+// 	Put the translation of "virtAddr" in the host translation cache,
+//	in place of whatever page was cached in its slot.  Translate has
+//	just succeeded, so the page is in the page table or the TLB.
+//
+//	"virtAddr" -- the virtual address just translated
+//----------------------------------------------------------------------
+
+void
+Machine::CacheTranslation(int virtAddr)
+{
+    unsigned int vpn = (unsigned) virtAddr / PageSize;
+    HostTranslation *cached = &hostCache[vpn % HostCacheSize];
+    int i, set;
+
+    cached->tlbIndex = -1;
+    if (tlb == NULL) {
+	cached->entry = &pageTable[vpn];
+    } else {
+	set = TlbSet(vpn);
+	for (i = set; i < set + tlbWays; i++)
+	    if (tlb[i].valid && tlb[i].virtualPage == (int) vpn)
+		break;
+	ASSERT(i < set + tlbWays);
+	cached->entry = &tlb[i];
+	cached->tlbIndex = i;
+    }
+    cached->frame = cached->entry->physicalPage;
+    cached->vpn = vpn;
+}
+
+//----------------------------------------------------------------------
+// Machine::FlushHostCache
+// 	Empty the host translation cache.  The kernel calls this when
+//	another page table is put in use, or the TLB is emptied, since
+//	every cached translation points into the old one.
+//----------------------------------------------------------------------
+
+void
+Machine::FlushHostCache()
+{
+    for (int i = 0; i < HostCacheSize; i++)
+	hostCache[i].vpn = -1;
+}
+
+//----------------------------------------------------------------------
+// Machine::InvalidateHostPage
+// 	Drop virtual page "vpn" from the host translation cache, if it is
+//	there.  The kernel calls this before it changes the page table
+//	entry for "vpn" (or replaces the TLB entry), so that the next
+//	access goes through Translate and sees the change.
+//
+//	"vpn" -- the virtual page whose translation is changing
+//----------------------------------------------------------------------
+
+void
+Machine::InvalidateHostPage(int vpn)
+{
+    HostTranslation *cached = &hostCache[(unsigned) vpn % HostCacheSize];
+
+    if (cached->vpn == vpn)
+	cached->vpn = -1;
+}
@@ -0,0 +1,39 @@
+#include "syscall.h"
+#include "bufio.h"
+
+/* FS_test3's byte-at-a-time writes, but through bufio: the bytes go
+ * to the kernel one buffer-full per Write system call.  Then read the
+ * file back a byte at a time and check it.
+ */
+
+int main(void)
+{
+	char test[] = "abcdefghijklmnopqrstuvwxyz\n";
+	int iterations = 100;
+	int length = 27 * iterations;
+	int success = Create("/file7", length);
+	BufFile *file;
+	char c;
+	int i;
+	if (success != 1) MSG("Failed on creating file");
+	file = FOpen("/file7");
+	if (file == 0) MSG("Failed on opening file");
+	for (i = 0; i < length; ++i) {
+		int count = FWrite(test + (i % 27), 1, file);
+		if (count != 1) MSG("Failed on writing file");
+	}
+	success = FClose(file);
+	if (success != 1) MSG("Failed on closing file");
+
+	file = FOpen("/file7");
+	if (file == 0) MSG("Failed on opening file");
+	for (i = 0; i < length; ++i) {
+		if (FRead(&c, 1, file) != 1) MSG("Failed on reading file");
+		if (c != test[i % 27]) MSG("Failed: reading wrong result");
+	}
+	if (FRead(&c, 1, file) != 0) MSG("Failed: read past end of file");
+	success = FClose(file);
+	if (success != 1) MSG("Failed on closing file");
+	MSG("Passed! ^_^");
+	Halt();
+}
@@ -0,0 +1,4 @@
+../build.linux/nachos -f
+../build.linux/nachos -cp FS_bufio /FS_bufio
+../build.linux/nachos -e /FS_bufio
+../build.linux/nachos -p /file7
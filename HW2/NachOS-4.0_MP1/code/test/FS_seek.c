@@ -0,0 +1,50 @@
+#include "syscall.h"
+
+/* Random-access benchmark: fill a file with a known pattern, then
+ * read it back at pseudo-random offsets using Seek, checking every
+ * byte.  Each access costs one Seek and one Read, however far into
+ * the file it lands.  Finally Remove the file and make sure it's gone.
+ */
+
+int main(void)
+{
+	char test[] = "abcdefghijklmnopqrstuvwxyz";
+	char buf[16];
+	int iterations = 400;
+	int length = 26 * iterations;
+	int accesses = 1000;
+	unsigned seed = 12345;
+	int success, count, position, i, j;
+	OpenFileId fid;
+
+	success = Create("/file5", length);
+	if (success != 1) MSG("Failed on creating file");
+	fid = Open("/file5");
+	if (fid <= 0) MSG("Failed on opening file");
+	for (i = 0; i < iterations; ++i) {
+		count = Write(test, 26, fid);
+		if (count != 26) MSG("Failed on writing file");
+	}
+
+	for (i = 0; i < accesses; ++i) {
+		seed = seed * 1103515245 + 12345;
+		position = (seed >> 8) % (length - 16);
+		success = Seek(position, fid);
+		if (success != 1) MSG("Failed on seeking file");
+		count = Read(buf, 16, fid);
+		if (count != 16) MSG("Failed on reading file");
+		for (j = 0; j < 16; ++j) {
+			if (buf[j] != test[(position + j) % 26])
+				MSG("Failed: reading wrong result");
+		}
+	}
+	if (Seek(-1, fid) != -1) MSG("Failed: seek to negative position");
+
+	if (Remove("/file5") != 0) MSG("Failed: removed an open file");
+	success = Close(fid);
+	if (success != 1) MSG("Failed on closing file");
+	if (Remove("/file5") != 1) MSG("Failed on removing file");
+	if (Open("/file5") != -1) MSG("Failed: file still there after remove");
+	MSG("Passed! ^_^");
+	Halt();
+}
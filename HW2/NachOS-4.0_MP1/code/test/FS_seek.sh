@@ -0,0 +1,4 @@
+../build.linux/nachos -f
+../build.linux/nachos -cp FS_seek /FS_seek
+../build.linux/nachos -e /FS_seek
+../build.linux/nachos -l /
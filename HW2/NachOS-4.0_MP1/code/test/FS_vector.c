@@ -0,0 +1,50 @@
+#include "syscall.h"
+
+/* Write a file from several scattered buffers with one WriteV, read
+ * it back into differently sized buffers with one ReadV, then patch
+ * and check single spots with PWrite/PRead, which must leave the
+ * seek position where it was.
+ */
+
+int main(void)
+{
+	char lower[] = "abcdefghijklmnopqrstuvwxyz";
+	char upper[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+	char digits[] = "0123456789\n";
+	char check[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789\n";
+	char first[40], second[23], c;
+	IoVec iov[3];
+	OpenFileId fid;
+	int success, count, i;
+
+	success = Create("/file6", 63);
+	if (success != 1) MSG("Failed on creating file");
+	fid = Open("/file6");
+	if (fid <= 0) MSG("Failed on opening file");
+
+	iov[0].buffer = lower;  iov[0].size = 26;
+	iov[1].buffer = upper;  iov[1].size = 26;
+	iov[2].buffer = digits; iov[2].size = 11;
+	count = WriteV(iov, 3, fid);
+	if (count != 63) MSG("Failed on writing file");
+
+	if (Seek(0, fid) != 1) MSG("Failed on seeking file");
+	iov[0].buffer = first;  iov[0].size = 40;
+	iov[1].buffer = second; iov[1].size = 23;
+	count = ReadV(iov, 2, fid);
+	if (count != 63) MSG("Failed on reading file");
+	for (i = 0; i < 40; ++i)
+		if (first[i] != check[i]) MSG("Failed: reading wrong result");
+	for (i = 0; i < 23; ++i)
+		if (second[i] != check[40 + i]) MSG("Failed: reading wrong result");
+
+	if (Seek(10, fid) != 1) MSG("Failed on seeking file");
+	if (PWrite("#", 1, 30, fid) != 1) MSG("Failed on writing file");
+	if (PRead(&c, 1, 30, fid) != 1 || c != '#') MSG("Failed: reading wrong result");
+	if (Read(&c, 1, fid) != 1 || c != 'k') MSG("Failed: seek position moved");
+
+	success = Close(fid);
+	if (success != 1) MSG("Failed on closing file");
+	MSG("Passed! ^_^");
+	Halt();
+}
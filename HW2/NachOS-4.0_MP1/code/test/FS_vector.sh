@@ -0,0 +1,4 @@
+../build.linux/nachos -f
+../build.linux/nachos -cp FS_vector /FS_vector
+../build.linux/nachos -e /FS_vector
+../build.linux/nachos -p /file6
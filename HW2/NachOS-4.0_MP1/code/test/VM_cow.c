@@ -0,0 +1,33 @@
+#include "syscall.h"
+
+/* Shared image test: run several copies at once.  They share the
+ * frames of the code and of the initialized array below, until each
+ * writes the array and gets copies of its own.  So every copy must
+ * find the array as the executable has it, whatever the others did to
+ * theirs, and must read back what it wrote itself.
+ */
+
+#define Size	1024		/* 32 pages */
+
+int data[Size] = { 7 };
+
+int main(void)
+{
+	int i, pass;
+
+	if (data[0] != 7)
+		Exit(0);
+	for (i = 1; i < Size; ++i) {
+		if (data[i] != 0)
+			Exit(0);
+	}
+	for (pass = 1; pass <= 3; ++pass) {
+		for (i = 0; i < Size; ++i)
+			data[i] = i * pass;
+		for (i = 0; i < Size; ++i) {
+			if (data[i] != i * pass)
+				Exit(0);
+		}
+	}
+	Exit(1);
+}
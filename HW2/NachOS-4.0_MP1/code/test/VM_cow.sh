@@ -0,0 +1,4 @@
+../build.linux/nachos -f
+../build.linux/nachos -cp VM_cow /VM_cow
+../build.linux/nachos -e /VM_cow -e /VM_cow -e /VM_cow
+../build.linux/nachos -tlb 8 2 lru -e /VM_cow -e /VM_cow
@@ -0,0 +1,35 @@
+#include "syscall.h"
+
+/* Page replacement test: matmult.c with matrices too big for physical
+ * memory (three 40x40 int matrices are 150 pages; there are 128
+ * frames).  A and B are only read once they are set up, so most
+ * evictions should find clean pages that need not be written to swap.
+ * Checks every element of the product, then exits with 1.
+ */
+
+#define Dim	40
+
+int A[Dim][Dim];
+int B[Dim][Dim];
+int C[Dim][Dim];
+
+int main(void)
+{
+	int i, j, k;
+
+	for (i = 0; i < Dim; i++)
+		for (j = 0; j < Dim; j++) {
+			A[i][j] = i;
+			B[i][j] = j;
+			C[i][j] = 0;
+		}
+	for (i = 0; i < Dim; i++)
+		for (j = 0; j < Dim; j++)
+			for (k = 0; k < Dim; k++)
+				C[i][j] += A[i][k] * B[k][j];
+	for (i = 0; i < Dim; i++)		/* C[i][j] = Dim * i * j */
+		for (j = 0; j < Dim; j++)
+			if (C[i][j] != Dim * i * j)
+				Exit(0);
+	Exit(1);
+}
@@ -0,0 +1,3 @@
+../build.linux/nachos -f
+../build.linux/nachos -cp VM_matmult /VM_matmult
+../build.linux/nachos -e /VM_matmult
@@ -0,0 +1,61 @@
+#include "syscall.h"
+
+/* Mapped file test: fill a file with a known pattern, map it, and
+ * check every byte through the mapping -- one Mmap in place of a Read
+ * for every piece.  Then capitalize it in place, unmap it, and read
+ * the file back to make sure the changes went to the file.  A second
+ * mapping, of the file's second half, is left for Exit to write back:
+ * the file should end up capitalized up to byte 1280, and lower case
+ * after that.
+ */
+
+int main(void)
+{
+	char test[] = "abcdefghijklmnopqrstuvwxyz";
+	char buf[26];
+	int iterations = 100;
+	int length = 26 * iterations;
+	int half = 1280;		/* a multiple of the page size */
+	int count, i, j;
+	char *map;
+	OpenFileId fid;
+
+	Remove("/file6");		/* from an earlier run */
+	if (Create("/file6", length) != 1) MSG("Failed on creating file");
+	fid = Open("/file6");
+	if (fid <= 0) MSG("Failed on opening file");
+	for (i = 0; i < iterations; ++i) {
+		count = Write(test, 26, fid);
+		if (count != 26) MSG("Failed on writing file");
+	}
+
+	if ((int) Mmap(fid, 1, length) != -1) MSG("Failed: mapped an unaligned offset");
+	if ((int) Mmap(fid, 0, 0) != -1) MSG("Failed: mapped nothing");
+	map = Mmap(fid, 0, length);
+	if ((int) map == -1) MSG("Failed on mapping file");
+	if (Close(fid) != 1) MSG("Failed on closing file");
+	for (i = 0; i < length; ++i) {
+		if (map[i] != test[i % 26])
+			MSG("Failed: mapping has the wrong contents");
+	}
+	for (i = 0; i < length; ++i)
+		map[i] = map[i] - 'a' + 'A';
+	if (Munmap(map + 1) != -1) MSG("Failed: unmapped a bad address");
+	if (Munmap(map) != 1) MSG("Failed on unmapping file");
+
+	fid = Open("/file6");
+	if (fid <= 0) MSG("Failed on reopening file");
+	for (i = 0; i < iterations; ++i) {
+		if (PRead(buf, 26, 26 * i, fid) != 26) MSG("Failed on reading file");
+		for (j = 0; j < 26; ++j) {
+			if (buf[j] != test[j] - 'a' + 'A')
+				MSG("Failed: changes not written back");
+		}
+	}
+
+	map = Mmap(fid, half, length);
+	if ((int) map == -1) MSG("Failed on mapping second half");
+	for (i = 0; i < length - half; ++i)
+		map[i] = test[(half + i) % 26];
+	Exit(0);
+}
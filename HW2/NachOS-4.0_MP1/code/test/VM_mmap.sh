@@ -0,0 +1,5 @@
+../build.linux/nachos -f
+../build.linux/nachos -cp VM_mmap /VM_mmap
+../build.linux/nachos -e /VM_mmap
+../build.linux/nachos -p /file6
+../build.linux/nachos -tlb 8 2 clock -e /VM_mmap
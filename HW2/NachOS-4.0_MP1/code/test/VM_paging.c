@@ -0,0 +1,31 @@
+#include "syscall.h"
+
+/* Demand paging test: the array below is bigger than all of physical
+ * memory, so it can only be used if pages are brought in as they are
+ * touched and paged out to swap to make room.  Fill it, then read it
+ * back twice in different orders, checking every word.  Run two
+ * copies at once to make them fight over the frames.
+ */
+
+#define Size	6144		/* 24KB, physical memory is 16KB */
+
+int big[Size];
+
+int main(void)
+{
+	int i, stride;
+
+	for (i = 0; i < Size; ++i)
+		big[i] = i * 7 + 3;
+	for (i = 0; i < Size; ++i) {
+		if (big[i] != i * 7 + 3)
+			Exit(0);
+	}
+	for (stride = 0; stride < 32; ++stride) {	/* a page at a time */
+		for (i = stride; i < Size; i += 32) {
+			if (big[i] != i * 7 + 3)
+				Exit(0);
+		}
+	}
+	Exit(1);
+}
@@ -0,0 +1,3 @@
+../build.linux/nachos -f
+../build.linux/nachos -cp VM_paging /VM_paging
+../build.linux/nachos -e /VM_paging -e /VM_paging
@@ -0,0 +1,6 @@
+../build.linux/nachos -f
+../build.linux/nachos -cp matmult /matmult
+../build.linux/nachos -cp VM_paging /VM_paging
+../build.linux/nachos -tlb 4 4 random -e /matmult
+../build.linux/nachos -tlb 16 4 lru -e /matmult
+../build.linux/nachos -tlb 8 2 clock -e /VM_paging -e /VM_paging
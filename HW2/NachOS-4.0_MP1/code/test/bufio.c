@@ -0,0 +1,164 @@
+/* bufio.c
+ *	Buffered I/O for Nachos user programs, on top of the Open, Read,
+ *	Write, Seek and Close system calls.
+ *
+ *	A BufFile's buffer is either empty, holding bytes read ahead
+ *	from the file (start..end), or holding bytes written by the
+ *	program but not yet passed to Write (0..end).  Switching
+ *	direction flushes the written bytes, or gives back the bytes
+ *	read ahead by seeking to where the program really is.
+ *
+ * Copyright (c) 1992-1993 The Regents of the University of California.
+ * All rights reserved.  See copyright.h for copyright notice and limitation 
+ * of liability and disclaimer of warranty provisions.
+ */
+
+#include "bufio.h"
+
+static BufFile files[MaxBufFiles];
+static char buffers[MaxBufFiles][BufIoSize];
+static int inUse[MaxBufFiles];
+
+static void
+Copy(char *from, char *to, int n)
+{
+    while (n-- > 0)
+	*to++ = *from++;
+}
+
+BufFile *
+FOpen(char *name)
+{
+    int i;
+    OpenFileId fid;
+
+    for (i = 0; i < MaxBufFiles; i++)
+	if (!inUse[i])
+	    break;
+    if (i == MaxBufFiles)
+	return 0;
+    fid = Open(name);
+    if (fid < 0)
+	return 0;
+    inUse[i] = 1;
+    files[i].fid = fid;
+    files[i].buffer = buffers[i];
+    files[i].size = BufIoSize;
+    files[i].start = files[i].end = 0;
+    files[i].writing = 0;
+    files[i].position = 0;
+    return &files[i];
+}
+
+void
+FSetBuf(BufFile *file, char *buffer, int size)
+{
+    file->buffer = buffer;
+    file->size = size;
+    file->start = file->end = 0;
+}
+
+int
+FFlush(BufFile *file)
+{
+    int count;
+
+    if (file->writing) {
+	/* a short Write leaves the rest; write it until it is all out */
+	while (file->end > 0) {
+	    count = Write(file->buffer, file->end, file->fid);
+	    if (count <= 0)
+		return -1;	/* what is left stays in the buffer */
+	    file->position += count;
+	    Copy(file->buffer + count, file->buffer, file->end - count);
+	    file->end -= count;
+	}
+	file->writing = 0;
+    } else if (file->start < file->end) {
+	/* give back the bytes we read ahead */
+	file->position -= file->end - file->start;
+	Seek(file->position, file->fid);
+    }
+    file->start = file->end = 0;
+    return 0;
+}
+
+int
+FRead(char *buffer, int size, BufFile *file)
+{
+    int done = 0, n;
+
+    if (file->writing && FFlush(file) < 0)
+	return 0;
+    while (done < size) {
+	if (file->start == file->end) {
+	    if (size - done >= file->size) {
+		/* big request: read straight into the caller's buffer */
+		n = Read(buffer + done, size - done, file->fid);
+		if (n > 0) {
+		    file->position += n;
+		    done += n;
+		}
+		break;
+	    }
+	    n = Read(file->buffer, file->size, file->fid);
+	    if (n <= 0)
+		break;
+	    file->position += n;
+	    file->start = 0;
+	    file->end = n;
+	}
+	n = file->end - file->start;
+	if (n > size - done)
+	    n = size - done;
+	Copy(file->buffer + file->start, buffer + done, n);
+	file->start += n;
+	done += n;
+    }
+    return done;
+}
+
+int
+FWrite(char *buffer, int size, BufFile *file)
+{
+    int done = 0, n;
+
+    if (!file->writing) {
+	FFlush(file);
+	file->writing = 1;
+    }
+    while (done < size) {
+	if (file->end == 0 && size - done >= file->size) {
+	    /* big request: write straight from the caller's buffer */
+	    n = Write(buffer + done, size - done, file->fid);
+	    if (n > 0) {
+		file->position += n;
+		done += n;
+	    }
+	    break;
+	}
+	n = file->size - file->end;
+	if (n > size - done)
+	    n = size - done;
+	Copy(buffer + done, file->buffer + file->end, n);
+	file->end += n;
+	done += n;
+	if (file->end == file->size && FFlush(file) < 0)
+	    break;
+	file->writing = 1;
+    }
+    return done;
+}
+
+int
+FClose(BufFile *file)
+{
+    int flushed = FFlush(file);
+    int closed;
+
+    inUse[file - files] = 0;
+    closed = Close(file->fid);
+    if (flushed < 0)
+	return -1;
+    return closed;
+}
@@ -0,0 +1,69 @@
+/* bufio.h
+ *	A small buffered I/O library for Nachos user programs, in the
+ *	spirit of stdio's fopen/fread/fwrite/fflush.
+ *
+ *	Every Read or Write system call traps into the kernel, and a
+ *	Write of a few bytes still costs the kernel a whole sector
+ *	read-modify-write.  These routines batch small reads and writes
+ *	in a per-file buffer, so a program that writes a byte at a time
+ *	makes one Write system call per buffer-full instead of one per
+ *	byte.
+ *
+ *	There is no malloc in user programs, so the BufFile structures
+ *	and their default buffers come from a fixed pool.  The default
+ *	buffer size is BufIoSize; FSetBuf gives a file a buffer of any
+ *	size supplied by the caller.
+ *
+ * Copyright (c) 1992-1993 The Regents of the University of California.
+ * All rights reserved.  See copyright.h for copyright notice and limitation 
+ * of liability and disclaimer of warranty provisions.
+ */
+
+#ifndef BUFIO_H
+#define BUFIO_H
+
+#include "syscall.h"
+
+#ifndef BufIoSize
+#define BufIoSize	256	/* default buffer size, in bytes */
+#endif
+#define MaxBufFiles	4	/* most files open through bufio at once */
+
+typedef struct {
+    OpenFileId fid;	/* the underlying open file */
+    char *buffer;	/* buffered bytes */
+    int size;		/* capacity of buffer */
+    int start;		/* next byte to hand out, when reading */
+    int end;		/* one past the last valid byte */
+    int writing;	/* buffer holds bytes not yet written */
+    int position;	/* seek position of the underlying file */
+} BufFile;
+
+/* Open the Nachos file "name".  Return NULL (0) if it can't be opened
+ * or too many files are open through bufio.
+ */
+BufFile *FOpen(char *name);
+
+/* Use "buffer", of "size" bytes, for "file" instead of its default
+ * buffer.  Must be called before the first FRead or FWrite.
+ */
+void FSetBuf(BufFile *file, char *buffer, int size);
+
+/* Read/write "size" bytes through the buffer.  Return the number of
+ * bytes transferred; FRead returns less at end of file.
+ */
+int FRead(char *buffer, int size, BufFile *file);
+int FWrite(char *buffer, int size, BufFile *file);
+
+/* Write any buffered bytes out to the file.  Return -1 if some of
+ * them can't be written; those stay in the buffer.
+ */
+int FFlush(BufFile *file);
+
+/* Flush and close the file.  Return 1 on success, like Close, and
+ * -1 if the buffered bytes can't all be written; the file is closed
+ * either way.
+ */
+int FClose(BufFile *file);
+
+#endif /* BUFIO_H */
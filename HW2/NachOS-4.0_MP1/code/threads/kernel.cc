@@ -18,6 +18,13 @@
 #include "post.h"
 #include "synchconsole.h"
 #include "openfile.h"
+#include "frametable.h"
+#include "swap.h"
+#include "tlbmanager.h"
+#include "image.h"
+#ifndef FILESYS_STUB
+#include "inode.h"
+#endif
 
 //----------------------------------------------------------------------
 // Kernel::Kernel
@@ -29,6 +36,14 @@ Kernel::Kernel(int argc, char **argv)
 {
     randomSlice = FALSE; 
     debugUserProg = FALSE;
+    runBlocks = FALSE;
+#ifdef USE_TLB
+    tlbSize = TLBSize;		// fully associative
+#else
+    tlbSize = 0;		// use a linear page table
+#endif
+    tlbWays = tlbSize;
+    tlbPolicy = (char *) "random";
     consoleIn = NULL;          // default is stdin
     consoleOut = NULL;         // default is stdout
 #ifndef FILESYS_STUB
@@ -37,6 +52,7 @@ Kernel::Kernel(int argc, char **argv)
     reliability = 1;            // network reliability, default is 1.0
     hostName = 0;               // machine id, also UNIX socket name
                                 // 0 is the default machine id
+    printSyscallStats = FALSE;
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-rs") == 0) {
  	    	ASSERT(i + 1 < argc);
@@ -46,6 +62,14 @@ Kernel::Kernel(int argc, char **argv)
 	    	i++;
         } else if (strcmp(argv[i], "-s") == 0) {
             debugUserProg = TRUE;
+        } else if (strcmp(argv[i], "-B") == 0) {
+            runBlocks = TRUE;
+        } else if (strcmp(argv[i], "-tlb") == 0) {
+            ASSERT(i + 3 < argc);   // size, associativity, policy
+            tlbSize = atoi(argv[i + 1]);
+            tlbWays = atoi(argv[i + 2]);
+            tlbPolicy = argv[i + 3];
+            i += 3;
 		} else if (strcmp(argv[i], "-e") == 0) {
         	execfile[++execfileNum]= argv[++i];
 			cout << execfile[execfileNum] << "\n";
@@ -69,14 +93,18 @@ Kernel::Kernel(int argc, char **argv)
             ASSERT(i + 1 < argc);   // next argument is int
             hostName = atoi(argv[i + 1]);
             i++;
+        } else if (strcmp(argv[i], "-P") == 0) {
+            printSyscallStats = TRUE;
         } else if (strcmp(argv[i], "-u") == 0) {
             cout << "Partial usage: nachos [-rs randomSeed]\n";
-	   		cout << "Partial usage: nachos [-s]\n";
+	   		cout << "Partial usage: nachos [-s] [-B]\n";
+            cout << "Partial usage: nachos [-tlb size ways random|lru|clock]\n";
             cout << "Partial usage: nachos [-ci consoleIn] [-co consoleOut]\n";
 #ifndef FILESYS_STUB
 	    	cout << "Partial usage: nachos [-nf]\n";
 #endif
             cout << "Partial usage: nachos [-n #] [-m #]\n";
+            cout << "Partial usage: nachos [-P]\n";
 		}
     }
 }
@@ -103,15 +131,20 @@ Kernel::Initialize()
     interrupt = new Interrupt;		// start up interrupt handling
     scheduler = new Scheduler();	// initialize the ready queue
     alarm = new Alarm(randomSlice);	// start up time slicing
-    machine = new Machine(debugUserProg);
+    machine = new Machine(debugUserProg, runBlocks, tlbSize, tlbWays);
     synchConsoleIn = new SynchConsoleInput(consoleIn); // input from stdin
     synchConsoleOut = new SynchConsoleOutput(consoleOut); // output to stdout
     synchDisk = new SynchDisk();    //
 #ifdef FILESYS_STUB
     fileSystem = new FileSystem();
 #else
+    inodeTable = new InodeTable();	// before anything is opened
     fileSystem = new FileSystem(formatFlag);
 #endif // FILESYS_STUB
+    frameTable = new FrameTable(NumPhysPages);
+    swapSpace = new SwapSpace();	// the swap area is on the disk
+    imageCache = new ImageCache();
+    tlbManager = (tlbSize > 0) ? new TlbManager(tlbPolicy) : NULL;
     postOfficeIn = new PostOfficeInput(10);
     postOfficeOut = new PostOfficeOutput(reliability);
 
@@ -121,19 +154,51 @@ Kernel::Initialize()
 //----------------------------------------------------------------------
 // Kernel::~Kernel
 // 	Nachos is halting.  De-allocate global data structures.
+//
+//	The address spaces of the programs still running are deleted
+//	first, while the file system can still take back what they
+//	wrote to mapped files and close the files they left open.  The
+//	ready threads are taken off the ready list so none of them runs
+//	again while that waits for the disk; that is done holding the
+//	frame table lock, so none of them is left holding it.
 //----------------------------------------------------------------------
 
 Kernel::~Kernel()
 {
+    List<Thread *> *halted = new List<Thread *>;
+    Thread *thread;
+
+    frameTable->Acquire();
+    while ((thread = scheduler->FindNextToRun()) != NULL)
+	halted->Append(thread);
+    frameTable->Release();
+    while (!halted->IsEmpty()) {
+	thread = halted->RemoveFront();
+	delete thread->space;
+	thread->space = NULL;
+    }
+    delete halted;
+    delete currentThread->space;
+    currentThread->space = NULL;
+
+    delete imageCache;		// images of blocked programs, before the
+				// frames and the files they use
+    delete fileSystem;		// it may still have to write 
+				// the superblock through the disk
+#ifndef FILESYS_STUB
+    delete inodeTable;		// after the file system closes its files
+#endif
     delete stats;
     delete interrupt;
     delete scheduler;
     delete alarm;
     delete machine;
+    delete frameTable;
+    delete swapSpace;
+    delete tlbManager;
     delete synchConsoleIn;
     delete synchConsoleOut;
     delete synchDisk;
-    delete fileSystem;
     delete postOfficeIn;
     delete postOfficeOut;
     
@@ -26,6 +26,11 @@ class PostOfficeOutput;
 class SynchConsoleInput;
 class SynchConsoleOutput;
 class SynchDisk;
+class InodeTable;
+class FrameTable;
+class SwapSpace;
+class TlbManager;
+class ImageCache;
 
 
 
@@ -65,11 +70,21 @@ class Kernel {
     SynchConsoleInput *synchConsoleIn;
     SynchConsoleOutput *synchConsoleOut;
     SynchDisk *synchDisk;
+    InodeTable *inodeTable;	// headers of the files that are open
     FileSystem *fileSystem;     
+    FrameTable *frameTable;	// frames of main memory given to programs
+    SwapSpace *swapSpace;	// where pages go when their frame is taken
+    ImageCache *imageCache;	// executables being run, shared by the
+				// address spaces running them
+    TlbManager *tlbManager;	// refills the TLB, NULL if there is none
     PostOfficeInput *postOfficeIn;
     PostOfficeOutput *postOfficeOut;
 
     int hostName;               // machine identifier
+    bool printSyscallStats;	// print system call profile at Halt
+#ifndef FILESYS_STUB
+    bool formatFlag;          // format the disk if this is true
+#endif
 
   private:
 
@@ -79,12 +94,13 @@ class Kernel {
 	int threadNum;
     bool randomSlice;		// enable pseudo-random time slicing
     bool debugUserProg;         // single step user program
+    bool runBlocks;		// run user programs a basic block at a time
+    int tlbSize;		// entries in the TLB, 0 for a page table
+    int tlbWays;		// entries in each set of the TLB
+    char *tlbPolicy;		// TLB replacement: random, lru or clock
     double reliability;         // likelihood messages are dropped
     char *consoleIn;            // file to read console input from
     char *consoleOut;           // file to send console output to
-#ifndef FILESYS_STUB
-    bool formatFlag;          // format the disk if this is true
-#endif
 };
 
 
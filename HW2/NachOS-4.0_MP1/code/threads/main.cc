@@ -7,12 +7,17 @@
 //              -f -cp <unix file> <nachos file>
 //              -p <nachos file> -r <nachos file> -l -D
 //              -n <network reliability> -m <machine id>
-//              -z -K -C -N
+//              -z -K -C -N -P -B -tlb <size> <ways> <policy>
 //
 //    -d causes certain debugging messages to be printed (see debug.h)
 //    -rs causes Yield to occur at random (but repeatable) spots
 //    -z prints the copyright message
 //    -s causes user programs to be executed in single-step mode
+//    -B runs user programs with the basic block interpreter, which
+//       charges simulated time once per block (see Machine::RunBlocks)
+//    -tlb translates user addresses through a TLB of <size> entries, in
+//       sets of <ways>, that the kernel refills with the given replacement
+//       policy: random, lru or clock (see userprog/tlbmanager.h)
 //    -x runs a user program
 //    -ci specify file for console input (stdin is the default)
 //    -co specify file for console output (stdout is the default)
@@ -21,6 +26,8 @@
 //    -K run a simple self test of kernel threads and synchronization
 //    -C run an interactive console test
 //    -N run a two-machine network test (see Kernel::NetworkTest)
+//    -P prints the statistics, with a profile of the system calls
+//       made, at Halt (see Statistics::Print); -d T traces every call
 //
 //    Filesystem-related flags:
 //    -f forces the Nachos disk to be formatted
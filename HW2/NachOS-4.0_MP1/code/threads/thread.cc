@@ -170,6 +170,10 @@ Thread::Begin ()
 void
 Thread::Finish ()
 {
+    if (space != NULL) {			// a user program gives back its
+	delete space;				// memory and open files
+	space = NULL;
+    }
     (void) kernel->interrupt->SetLevel(IntOff);		
     ASSERT(this == kernel->currentThread);
     
@@ -19,76 +19,62 @@
 #include "main.h"
 #include "addrspace.h"
 #include "machine.h"
-#include "noff.h"
-
-//----------------------------------------------------------------------
-// SwapHeader
-// 	Do little endian to big endian conversion on the bytes in the 
-//	object file header, in case the file was generated on a little
-//	endian machine, and we're now running on a big endian machine.
-//----------------------------------------------------------------------
-
-static void 
-SwapHeader (NoffHeader *noffH)
-{
-    noffH->noffMagic = WordToHost(noffH->noffMagic);
-    noffH->code.size = WordToHost(noffH->code.size);
-    noffH->code.virtualAddr = WordToHost(noffH->code.virtualAddr);
-    noffH->code.inFileAddr = WordToHost(noffH->code.inFileAddr);
-#ifdef RDATA
-    noffH->readonlyData.size = WordToHost(noffH->readonlyData.size);
-    noffH->readonlyData.virtualAddr = 
-           WordToHost(noffH->readonlyData.virtualAddr);
-    noffH->readonlyData.inFileAddr = 
-           WordToHost(noffH->readonlyData.inFileAddr);
-#endif 
-    noffH->initData.size = WordToHost(noffH->initData.size);
-    noffH->initData.virtualAddr = WordToHost(noffH->initData.virtualAddr);
-    noffH->initData.inFileAddr = WordToHost(noffH->initData.inFileAddr);
-    noffH->uninitData.size = WordToHost(noffH->uninitData.size);
-    noffH->uninitData.virtualAddr = WordToHost(noffH->uninitData.virtualAddr);
-    noffH->uninitData.inFileAddr = WordToHost(noffH->uninitData.inFileAddr);
-
-#ifdef RDATA
-    DEBUG(dbgAddr, "code = " << noffH->code.size <<  
-                   " readonly = " << noffH->readonlyData.size <<
-                   " init = " << noffH->initData.size <<
-                   " uninit = " << noffH->uninitData.size << "\n");
-#endif
-}
+#include "frametable.h"
+#include "swap.h"
+#include "tlbmanager.h"
+#include "image.h"
 
 //----------------------------------------------------------------------
 // AddrSpace::AddrSpace
-// 	Create an address space to run a user program.
-//	Set up the translation from program memory to physical 
-//	memory.  For now, this is really simple (1:1), since we are
-//	only uniprogramming, and we have a single unsegmented page table
+// 	Create an address space to run a user program.  It has no pages
+//	until a program is loaded into it.
 //----------------------------------------------------------------------
 
 AddrSpace::AddrSpace()
 {
-    pageTable = new TranslationEntry[NumPhysPages];
-    for (int i = 0; i < NumPhysPages; i++) {
-	pageTable[i].virtualPage = i;	// for now, virt page # = phys page #
-	pageTable[i].physicalPage = i;
-	pageTable[i].valid = TRUE;
-	pageTable[i].use = FALSE;
-	pageTable[i].dirty = FALSE;
-	pageTable[i].readOnly = FALSE;  
-    }
-    
-    // zero out the entire address space
-    bzero(kernel->machine->mainMemory, MemorySize);
+    pageTable = NULL;
+    numPages = 0;
+    programPages = 0;
+    mappings = new List<MappedFile *>;
+    swapSlot = NULL;
+    shared = NULL;
+    image = NULL;
+    fileTable = new FileDescriptorTable(MaxOpenFiles);
 }
 
 //----------------------------------------------------------------------
 // AddrSpace::~AddrSpace
-// 	Dealloate an address space.
+// 	Dealloate an address space, giving back its frames and swap
+//	slots, and its share of the executable's image.  Files still
+//	mapped are unmapped first, so what the program wrote to them
+//	isn't lost.
 //----------------------------------------------------------------------
 
 AddrSpace::~AddrSpace()
 {
-   delete pageTable;
+    kernel->frameTable->Acquire();
+    while (!mappings->IsEmpty())
+	Unmap(mappings->Front());
+    for (unsigned int i = 0; i < numPages; i++) {
+	if (pageTable[i].valid && !shared[i])	// shared frames are
+	    kernel->frameTable->Free(pageTable[i].physicalPage);
+	if (swapSlot[i] != -1)			// the image's
+	    kernel->swapSpace->Free(swapSlot[i]);
+    }
+    if (image != NULL)
+	kernel->imageCache->Put(image, this);
+    kernel->frameTable->Release();
+    if (kernel->tlbManager != NULL && kernel->currentThread->space == this)
+	kernel->tlbManager->Flush(pageTable);
+    if (kernel->machine->pageTable == pageTable) {
+	kernel->machine->pageTable = NULL;
+	kernel->machine->FlushHostCache();
+    }
+    delete [] pageTable;
+    delete [] swapSlot;
+    delete [] shared;
+    delete mappings;
+    delete fileTable;			// closes what the program left open
 }
 
 
@@ -96,8 +82,11 @@ AddrSpace::~AddrSpace()
 // AddrSpace::Load
 // 	Load a user program into memory from a file.
 //
-//	Assumes that the page table has been initialized, and that
-//	the object code file is in NOFF format.
+//	Assumes that the object code file is in NOFF format.  Only the
+//	header is read here, and not even that if the program is already
+//	running.  The pages from the executable are read in
+//	as the program touches them, into its image, which is shared with
+//	any other address space running the same file (see image.h).
 //
 //	"fileName" is the file containing the object code to load into memory
 //----------------------------------------------------------------------
@@ -105,72 +94,440 @@ AddrSpace::~AddrSpace()
 bool 
 AddrSpace::Load(char *fileName) 
 {
-    OpenFile *executable = kernel->fileSystem->Open(fileName);
-    NoffHeader noffH;
+    NoffHeader *noffH;
     unsigned int size;
 
-    if (executable == NULL) {
+    image = kernel->imageCache->Get(fileName, this);
+    if (image == NULL) {
 	cerr << "Unable to open file " << fileName << "\n";
 	return FALSE;
     }
-
-    executable->ReadAt((char *)&noffH, sizeof(noffH), 0);
-    if ((noffH.noffMagic != NOFFMAGIC) && 
-		(WordToHost(noffH.noffMagic) == NOFFMAGIC))
-    	SwapHeader(&noffH);
-    ASSERT(noffH.noffMagic == NOFFMAGIC);
+    noffH = image->Header();
 
 #ifdef RDATA
 // how big is address space?
-    size = noffH.code.size + noffH.readonlyData.size + noffH.initData.size +
-           noffH.uninitData.size + UserStackSize;	
+    size = noffH->code.size + noffH->readonlyData.size + noffH->initData.size +
+           noffH->uninitData.size + UserStackSize;	
                                                 // we need to increase the size
 						// to leave room for the stack
 #else
 // how big is address space?
-    size = noffH.code.size + noffH.initData.size + noffH.uninitData.size 
+    size = noffH->code.size + noffH->initData.size + noffH->uninitData.size 
 			+ UserStackSize;	// we need to increase the size
 						// to leave room for the stack
 #endif
     numPages = divRoundUp(size, PageSize);
+    programPages = numPages;
     size = numPages * PageSize;
 
-    ASSERT(numPages <= NumPhysPages);		// check we're not trying
-						// to run anything too big --
-						// at least until we have
-						// virtual memory
-
     DEBUG(dbgAddr, "Initializing address space: " << numPages << ", " << size);
 
-// then, copy in the code and data segments into memory
-// Note: this code assumes that virtual address = physical address
-    if (noffH.code.size > 0) {
-        DEBUG(dbgAddr, "Initializing code segment.");
-	DEBUG(dbgAddr, noffH.code.virtualAddr << ", " << noffH.code.size);
-        executable->ReadAt(
-		&(kernel->machine->mainMemory[noffH.code.virtualAddr]), 
-			noffH.code.size, noffH.code.inFileAddr);
+// every page starts out not in memory; the first touch faults it in,
+// from the image if it comes from the executable
+    pageTable = new TranslationEntry[numPages];
+    swapSlot = new int[numPages];
+    shared = new bool[numPages];
+    for (unsigned int i = 0; i < numPages; i++) {
+	pageTable[i].virtualPage = i;
+	pageTable[i].physicalPage = -1;
+	pageTable[i].valid = FALSE;
+	pageTable[i].use = FALSE;
+	pageTable[i].dirty = FALSE;
+	pageTable[i].readOnly = FALSE;  
+	swapSlot[i] = -1;
+	shared[i] = ((int) i < image->NumPages());
     }
-    if (noffH.initData.size > 0) {
-        DEBUG(dbgAddr, "Initializing data segment.");
-	DEBUG(dbgAddr, noffH.initData.virtualAddr << ", " << noffH.initData.size);
-        executable->ReadAt(
-		&(kernel->machine->mainMemory[noffH.initData.virtualAddr]),
-			noffH.initData.size, noffH.initData.inFileAddr);
+    return TRUE;			// success
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::PageIn
+// 	Bring virtual page "vpn" into a frame of main memory, and make
+//	its page table entry valid.  A page from the executable that the
+//	program hasn't written is mapped read-only from the image, which
+//	reads it in if no one else has.  Otherwise, if the page was paged
+//	out, it comes back from swap; if it is part of a mapped file, it
+//	is read from the file; if neither, it is zero-filled -- it is
+//	part of the stack or uninitialized data.
+//	Return FALSE if "vpn" isn't in the address space: it is past the
+//	end, or in the gap a mapping left when it was removed.
+//
+//	Called on a page fault; the faulting instruction is then retried.
+//
+//	"vpn" -- the virtual page to bring in
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::PageIn(int vpn)
+{
+    FrameTable *frameTable = kernel->frameTable;
+    TranslationEntry *pte;
+    MappedFile *mapping = NULL;
+    char *frame;
+
+    if (vpn < 0 || (unsigned) vpn >= numPages)
+	return FALSE;
+    if ((unsigned) vpn >= programPages && (mapping = FindMapping(vpn)) == NULL)
+	return FALSE;
+    frameTable->Acquire();
+    pte = &pageTable[vpn];
+    if (!pte->valid) {
+	if (shared[vpn]) {
+	    DEBUG(dbgAddr, "Page " << vpn << " mapped from the image");
+	    pte->physicalPage = image->GetPage(vpn);
+	    pte->readOnly = TRUE;	// copy on write
+	} else {
+	    pte->physicalPage = frameTable->Allocate(this, vpn);
+	    frame = &kernel->machine->mainMemory[pte->physicalPage * PageSize];
+	    if (swapSlot[vpn] != -1) {
+		DEBUG(dbgAddr, "Page " << vpn << " in from swap slot " << swapSlot[vpn]);
+		kernel->swapSpace->ReadPage(swapSlot[vpn], frame);
+		kernel->stats->numSwapIns++;
+	    } else if (mapping != NULL) {
+		DEBUG(dbgAddr, "Page " << vpn << " read from its file at " << mapping->Position(vpn));
+		bzero(frame, PageSize);		// past the end of the file
+		mapping->file->ReadAt(frame, mapping->Bytes(vpn), 
+					mapping->Position(vpn));
+	    } else {
+		DEBUG(dbgAddr, "Page " << vpn << " zero-filled");
+		bzero(frame, PageSize);
+	    }
+	    kernel->machine->InvalidateCode(pte->physicalPage);
+	    pte->readOnly = FALSE;
+	}
+	pte->use = FALSE;
+	pte->dirty = FALSE;
+	pte->valid = TRUE;
+	kernel->stats->numPageFaults++;
     }
+    frameTable->Release();
+    return TRUE;
+}
 
-#ifdef RDATA
-    if (noffH.readonlyData.size > 0) {
-        DEBUG(dbgAddr, "Initializing read only data segment.");
-	DEBUG(dbgAddr, noffH.readonlyData.virtualAddr << ", " << noffH.readonlyData.size);
-        executable->ReadAt(
-		&(kernel->machine->mainMemory[noffH.readonlyData.virtualAddr]),
-			noffH.readonlyData.size, noffH.readonlyData.inFileAddr);
+//----------------------------------------------------------------------
+// AddrSpace::PageOut
+// 	Mark virtual page "vpn" not in memory, so that the frame table
+//	can give its frame to another page.  If the page is dirty, it is
+//	written out to swap; if not, the copy it was read from -- in swap
+//	-- is still good, and it is simply dropped.  A page of a mapped
+//	file is written back to the file instead.  The page is taken
+//	out of the page table before it is written, so the program can't
+//	change the page while it is on its way out.
+//
+//	Called by the frame table, which holds its lock, only for pages
+//	in frames of our own; the image takes care of shared ones.
+//
+//	"vpn" -- the virtual page to page out
+//----------------------------------------------------------------------
+
+void
+AddrSpace::PageOut(int vpn)
+{
+    TranslationEntry *pte = &pageTable[vpn];
+    MappedFile *mapping;
+
+    ASSERT(pte->valid && !shared[vpn]);
+    DropPage(vpn);
+    if (!pte->dirty) {
+	DEBUG(dbgAddr, "Page " << vpn << " is clean, not written out");
+	return;
     }
-#endif
+    if ((unsigned) vpn >= programPages && (mapping = FindMapping(vpn)) != NULL) {
+	WriteBack(mapping, vpn);
+	return;
+    }
+    if (swapSlot[vpn] == -1) {
+	swapSlot[vpn] = kernel->swapSpace->Allocate();
+	ASSERT(swapSlot[vpn] != -1);	// out of swap space
+    }
+    DEBUG(dbgAddr, "Page " << vpn << " out to swap slot " << swapSlot[vpn]);
+    kernel->swapSpace->WritePage(swapSlot[vpn], 
+		&kernel->machine->mainMemory[pte->physicalPage * PageSize]);
+    kernel->stats->numSwapOuts++;
+}
 
-    delete executable;			// close file
-    return TRUE;			// success
+//----------------------------------------------------------------------
+// AddrSpace::TestAndClearUse
+// 	Return whether virtual page "vpn" has been used since the last
+//	time this was called on it, and clear its use bit.  If the page
+//	is in the TLB, the bit is there, so the page is dropped from the
+//	TLB first.
+//
+//	Called by the frame table, which holds its lock.
+//
+//	"vpn" -- a virtual page that is in memory
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::TestAndClearUse(int vpn)
+{
+    TranslationEntry *pte = &pageTable[vpn];
+    bool used;
+
+    ASSERT(pte->valid);
+    if (kernel->tlbManager != NULL && kernel->currentThread->space == this)
+	kernel->tlbManager->FlushPage(pageTable, vpn);
+    used = pte->use;
+    pte->use = FALSE;
+    return used;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::DropPage
+// 	Take virtual page "vpn" out of the page table, and out of the
+//	TLB and the simulator's translation cache, which may have copies
+//	of its page table entry.  If the page was in the TLB, the use and
+//	dirty bits the hardware set there are copied back first.
+//
+//	"vpn" -- the virtual page to drop
+//----------------------------------------------------------------------
+
+void
+AddrSpace::DropPage(int vpn)
+{
+    if (kernel->tlbManager != NULL && kernel->currentThread->space == this)
+	kernel->tlbManager->FlushPage(pageTable, vpn);
+    kernel->machine->InvalidateHostPage(vpn);	// harmless if the cached
+    pageTable[vpn].valid = FALSE;		// page is someone else's
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::MapsShared
+// 	Return whether virtual page "vpn" is mapped, copy on write, to
+//	"frame", a frame of the image.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::MapsShared(int vpn, int frame)
+{
+    return shared[vpn] && pageTable[vpn].valid 
+		&& pageTable[vpn].physicalPage == frame;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyOnWrite
+// 	Give virtual page "vpn" a private, writable copy of its page of
+//	the image, because the program (or the kernel, on its behalf) is
+//	about to write it.  Return FALSE if the page isn't copy on write
+//	-- the write is to a page that really is read-only.
+//
+//	"vpn" -- the virtual page being written
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::CopyOnWrite(unsigned int vpn)
+{
+    FrameTable *frameTable = kernel->frameTable;
+    TranslationEntry *pte = &pageTable[vpn];
+    char *memory = kernel->machine->mainMemory;
+    int source, frame;
+
+    if (vpn >= numPages || !shared[vpn])
+	return FALSE;
+    frameTable->Acquire();
+    source = image->GetPage(vpn);
+    frame = frameTable->Allocate(this, vpn);
+    if (frame != source) {	// else "source" itself was evicted; it is
+				// clean, so it still holds the page
+	bcopy(&memory[source * PageSize], &memory[frame * PageSize], PageSize);
+	kernel->machine->InvalidateCode(frame);
+    }
+    DEBUG(dbgAddr, "Page " << vpn << " copied on write to frame " << frame);
+    DropPage(vpn);
+    shared[vpn] = FALSE;
+    pte->physicalPage = frame;
+    pte->readOnly = FALSE;
+    pte->use = TRUE;
+    pte->dirty = TRUE;			// no longer the executable's copy
+    pte->valid = TRUE;
+    frameTable->Release();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Mmap
+// 	Map "length" bytes of an open file, from byte "offset" on, into
+//	the address space, and return the virtual address of the first
+//	of them.  Nothing is read yet: each page is read from the file
+//	the first time the program touches it, so a program can go
+//	through a large file without a system call for every piece.
+//	The mapping has its own open of the file, so it stays good if
+//	the program closes "file".
+//
+//	The mapping starts on a page boundary, after the stack and any
+//	other mappings; "offset" must be a multiple of PageSize too.
+//	The mapping doesn't go past the end of the file.
+//	Return -1 if "offset" or "length" is no good, or the file isn't
+//	one of the Nachos file system's.
+//
+//	"file" -- the file to map
+//	"offset" -- where in the file the mapping starts
+//	"length" -- how many bytes to map
+//----------------------------------------------------------------------
+
+int
+AddrSpace::Mmap(OpenFile *file, int offset, int length)
+{
+    MappedFile *mapping;
+    int firstPage, end;
+
+    if (offset < 0 || offset % PageSize != 0 || length <= 0 
+			|| offset >= file->Length() || file->Sector() == -1)
+	return -1;
+    length = min(length, file->Length() - offset);
+
+    kernel->frameTable->Acquire();
+    firstPage = programPages;
+    ListIterator<MappedFile *> it(mappings);
+    for (; !it.IsDone(); it.Next()) {
+	end = it.Item()->firstPage + it.Item()->numPages;
+	firstPage = max(firstPage, end);
+    }
+    mapping = new MappedFile(new OpenFile(file->Sector()), offset, length,
+				firstPage);
+    if ((unsigned) (firstPage + mapping->numPages) > numPages)
+	Grow(firstPage + mapping->numPages);
+    mappings->Append(mapping);
+    kernel->frameTable->Release();
+
+    DEBUG(dbgAddr, "Mapped " << length << " bytes at " << offset << " to page " << firstPage);
+    return firstPage * PageSize;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Munmap
+// 	Remove the mapping Mmap returned "vaddr" for, writing the pages
+//	the program changed back to the file.  Return FALSE if "vaddr"
+//	isn't the start of a mapping.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::Munmap(int vaddr)
+{
+    MappedFile *mapping = NULL;
+
+    if (vaddr < 0 || vaddr % PageSize != 0)
+	return FALSE;
+    kernel->frameTable->Acquire();
+    ListIterator<MappedFile *> it(mappings);
+    for (; !it.IsDone(); it.Next()) {
+	if (it.Item()->firstPage == vaddr / PageSize)
+	    mapping = it.Item();
+    }
+    if (mapping != NULL)
+	Unmap(mapping);
+    kernel->frameTable->Release();
+    return mapping != NULL;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Unmap
+// 	Remove "mapping" from the address space.  Its pages that are in
+//	memory are dropped from the page table, written back to the
+//	file if they are dirty, and their frames freed.  The pages stay
+//	in the page table, but are no longer part of the address space;
+//	a later mapping may use them again.
+//
+//	The caller holds the frame table's lock.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::Unmap(MappedFile *mapping)
+{
+    int vpn;
+
+    for (int i = 0; i < mapping->numPages; i++) {
+	vpn = mapping->firstPage + i;
+	if (!pageTable[vpn].valid)
+	    continue;
+	DropPage(vpn);			// brings back the TLB's dirty bit
+	if (pageTable[vpn].dirty)
+	    WriteBack(mapping, vpn);
+	kernel->frameTable->Free(pageTable[vpn].physicalPage);
+    }
+    mappings->Remove(mapping);
+    delete mapping;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::WriteBack
+// 	Write the frame of virtual page "vpn" back to where it came from
+//	in "mapping"'s file.  The page has already been dropped from the
+//	page table.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::WriteBack(MappedFile *mapping, int vpn)
+{
+    DEBUG(dbgAddr, "Page " << vpn << " written back to its file at " << mapping->Position(vpn));
+    mapping->file->WriteAt(
+		&kernel->machine->mainMemory[pageTable[vpn].physicalPage * PageSize],
+		mapping->Bytes(vpn), mapping->Position(vpn));
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FindMapping
+// 	Return the mapping virtual page "vpn" is part of, or NULL if it
+//	isn't part of any.
+//----------------------------------------------------------------------
+
+MappedFile *
+AddrSpace::FindMapping(int vpn)
+{
+    ListIterator<MappedFile *> it(mappings);
+
+    for (; !it.IsDone(); it.Next()) {
+	if (it.Item()->Contains(vpn))
+	    return it.Item();
+    }
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Grow
+// 	Make the address space "newNumPages" pages long, to make room
+//	for a mapping.  The new pages aren't in memory.  The page table
+//	moves, so the machine is told where it went, and the translations
+//	the simulator cached from the old one are thrown away.
+//
+//	The caller holds the frame table's lock.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::Grow(unsigned int newNumPages)
+{
+    TranslationEntry *newTable = new TranslationEntry[newNumPages];
+    int *newSwapSlot = new int[newNumPages];
+    bool *newShared = new bool[newNumPages];
+
+    for (unsigned int i = 0; i < newNumPages; i++) {
+	if (i < numPages) {
+	    newTable[i] = pageTable[i];
+	    newSwapSlot[i] = swapSlot[i];
+	    newShared[i] = shared[i];
+	    continue;
+	}
+	newTable[i].virtualPage = i;
+	newTable[i].physicalPage = -1;
+	newTable[i].valid = FALSE;
+	newTable[i].use = FALSE;
+	newTable[i].dirty = FALSE;
+	newTable[i].readOnly = FALSE;
+	newSwapSlot[i] = -1;
+	newShared[i] = FALSE;
+    }
+    if (kernel->machine->pageTable == pageTable) {
+	kernel->machine->pageTable = newTable;
+	kernel->machine->pageTableSize = newNumPages;
+    }
+    kernel->machine->FlushHostCache();
+    delete [] pageTable;
+    delete [] swapSlot;
+    delete [] shared;
+    pageTable = newTable;
+    swapSlot = newSwapSlot;
+    shared = newShared;
+    numPages = newNumPages;
 }
 
 //----------------------------------------------------------------------
@@ -231,8 +588,29 @@ AddrSpace::InitRegisters()
    // Set the stack register to the end of the address space, where we
    // allocated the stack; but subtract off a bit, to make sure we don't
    // accidentally reference off the end!
-    machine->WriteRegister(StackReg, numPages * PageSize - 16);
-    DEBUG(dbgAddr, "Initializing stack pointer: " << numPages * PageSize - 16);
+    machine->WriteRegister(StackReg, programPages * PageSize - 16);
+    DEBUG(dbgAddr, "Initializing stack pointer: " << programPages * PageSize - 16);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::RefillTlb
+// 	Load the translation for virtual page "vpn" into the TLB, after
+//	a reference to it missed, paging it in first if need be.
+//	Return FALSE if "vpn" isn't in the address space at all.
+//
+//	"vpn" -- the virtual page that missed in the TLB
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::RefillTlb(unsigned int vpn)
+{
+    if (vpn >= numPages)
+	return FALSE;
+    while (!pageTable[vpn].valid)	// as in Translate
+	if (!PageIn(vpn))
+	    return FALSE;
+    kernel->tlbManager->Refill(pageTable, vpn);
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
@@ -240,22 +618,31 @@ AddrSpace::InitRegisters()
 // 	On a context switch, save any machine state, specific
 //	to this address space, that needs saving.
 //
-//	For now, don't need to save anything!
+//	If there is a TLB, empty it: its entries don't say which address
+//	space they belong to.
 //----------------------------------------------------------------------
 
 void AddrSpace::SaveState() 
-{}
+{
+    if (kernel->tlbManager != NULL)
+	kernel->tlbManager->Flush(pageTable);
+}
 
 //----------------------------------------------------------------------
 // AddrSpace::RestoreState
 // 	On a context switch, restore the machine state so that
 //	this address space can run.
 //
-//      For now, tell the machine where to find the page table.
+//      Tell the machine where to find the page table, unless it
+//	translates through the TLB, which is refilled on demand.  Either
+//	way, the translations the simulator has cached are someone else's.
 //----------------------------------------------------------------------
 
 void AddrSpace::RestoreState() 
 {
+    kernel->machine->FlushHostCache();
+    if (kernel->tlbManager != NULL)
+	return;
     kernel->machine->pageTable = pageTable;
     kernel->machine->pageTableSize = numPages;
 }
@@ -283,8 +670,16 @@ AddrSpace::Translate(unsigned int vaddr, unsigned int *paddr, int isReadWrite)
 
     pte = &pageTable[vpn];
 
-    if(isReadWrite && pte->readOnly) {
-        return ReadOnlyException;
+    // paging in or copying on write may wait for the disk or give up
+    // the CPU, and meanwhile someone else may take the frame again;
+    // check once more before using it
+    while (!pte->valid || (isReadWrite && pte->readOnly)) {
+        if (!pte->valid) {
+            if (!PageIn(vpn))
+                return AddressErrorException;
+        } else if (!CopyOnWrite(vpn)) {
+            return ReadOnlyException;
+        }
     }
 
     pfn = pte->physicalPage;
@@ -311,6 +706,144 @@ AddrSpace::Translate(unsigned int vaddr, unsigned int *paddr, int isReadWrite)
     return NoException;
 }
 
+//----------------------------------------------------------------------
+// AddrSpace::ValidRange
+// 	Return TRUE if the "numBytes" bytes of user memory at virtual
+//	address "vaddr" all lie in the address space.  With "writing",
+//	each page is also translated for writing, so that a system call
+//	can find out that a buffer is read-only before it does anything
+//	it can't undo, like consuming data from a file.
+//
+//	"vaddr" -- the user address of the first byte
+//	"numBytes" -- the number of bytes
+//	"writing" -- will the kernel write to them?
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::ValidRange(int vaddr, int numBytes, bool writing)
+{
+    unsigned int size = numPages * PageSize;
+    unsigned int paddr;
+
+    if (vaddr < 0 || numBytes < 0 || (unsigned int) numBytes > size
+	|| (unsigned int) vaddr > size - numBytes)
+	return FALSE;
+    if (writing) {
+	for (int vpn = vaddr / PageSize; vpn * PageSize < vaddr + numBytes;
+	     vpn++) {
+	    if (Translate(vpn * PageSize, &paddr, 1) != NoException)
+		return FALSE;
+	}
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyIn
+// 	Copy "numBytes" bytes of user memory, starting at virtual address
+//	"vaddr", into the kernel buffer "into".  Each page is translated
+//	once and the bytes on it are copied in one piece, so a buffer
+//	costs one translation per page, not one per byte.
+//	Return FALSE, having copied only part of the buffer, if some page
+//	of it isn't in the address space.
+//
+//	"vaddr" -- the user address of the first byte
+//	"into" -- the kernel buffer to copy into
+//	"numBytes" -- the number of bytes to copy
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::CopyIn(int vaddr, char *into, int numBytes)
+{
+    unsigned int paddr;
+    int chunk;
+
+    if (vaddr < 0 || numBytes < 0)
+	return FALSE;
+    while (numBytes > 0) {
+	if (Translate(vaddr, &paddr, 0) != NoException)
+	    return FALSE;
+	chunk = min(numBytes, PageSize - (vaddr % PageSize));
+	bcopy(&kernel->machine->mainMemory[paddr], into, chunk);
+	vaddr += chunk;
+	into += chunk;
+	numBytes -= chunk;
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyOut
+// 	Copy "numBytes" bytes from the kernel buffer "from" out to user
+//	memory starting at virtual address "vaddr", a page at a time.
+//	Return FALSE, having copied only part of the buffer, if some page
+//	isn't in the address space or is read-only.
+//
+//	"from" -- the kernel buffer to copy from
+//	"vaddr" -- the user address of the first byte
+//	"numBytes" -- the number of bytes to copy
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::CopyOut(char *from, int vaddr, int numBytes)
+{
+    unsigned int paddr;
+    int chunk;
+
+    if (vaddr < 0 || numBytes < 0)
+	return FALSE;
+    while (numBytes > 0) {
+	if (Translate(vaddr, &paddr, 1) != NoException)
+	    return FALSE;
+	chunk = min(numBytes, PageSize - (vaddr % PageSize));
+	bcopy(from, &kernel->machine->mainMemory[paddr], chunk);
+	kernel->machine->InvalidateCode(paddr / PageSize);
+	vaddr += chunk;
+	from += chunk;
+	numBytes -= chunk;
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyInString
+// 	Copy a null-terminated string from user memory at virtual address
+//	"vaddr" into the kernel buffer "into".  The string is scanned for
+//	its terminator a page at a time.  Return the length of the string,
+//	or -1 if it doesn't fit in "maxBytes" bytes (terminator included)
+//	or runs off the address space.
+//
+//	"vaddr" -- the user address of the string
+//	"into" -- the kernel buffer, at least "maxBytes" long
+//	"maxBytes" -- the size of "into"
+//----------------------------------------------------------------------
+
+int
+AddrSpace::CopyInString(int vaddr, char *into, int maxBytes)
+{
+    unsigned int paddr;
+    int chunk, length = 0;
+    char *page, *end;
+
+    if (vaddr < 0)
+	return -1;
+    while (length < maxBytes) {
+	if (Translate(vaddr, &paddr, 0) != NoException)
+	    return -1;
+	chunk = min(maxBytes - length, PageSize - (vaddr % PageSize));
+	page = &kernel->machine->mainMemory[paddr];
+	end = (char *) memchr(page, '\0', chunk);
+	if (end != NULL) {
+	    bcopy(page, into + length, end - page + 1);
+	    return length + (end - page);
+	}
+	bcopy(page, into + length, chunk);
+	vaddr += chunk;
+	length += chunk;
+    }
+    return -1;				// no terminator within maxBytes
+}
+
 
 
 
@@ -2,10 +2,19 @@
 //	Data structures to keep track of executing user programs 
 //	(address spaces).
 //
-//	For now, we don't keep any information about address spaces.
 //	The user level CPU state is saved and restored in the thread
 //	executing the user program (see thread.h).
 //
+//	Pages are loaded on demand: Load only reads the executable's
+//	header, and each page is brought into a frame the first time the
+//	program touches it -- from the executable, from swap if it was
+//	paged out, or zero-filled for the stack and uninitialized data.
+//
+//	A program can also map part of an open file into its address
+//	space (Mmap).  The mapping gets pages of its own, above the
+//	stack; they are read from the file on first touch like any other
+//	page, and the file, not swap, is where they go back to.
+//
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
@@ -15,10 +24,42 @@
 
 #include "copyright.h"
 #include "filesys.h"
+#include "fdtable.h"
+#include "pageowner.h"
+#include "list.h"
 
 #define UserStackSize		1024 	// increase this as necessary!
 
-class AddrSpace {
+class Image;
+
+// A range of an open file mapped into an address space.  Page
+// "firstPage" holds the bytes at "offset" in the file, the next page
+// the ones after that, and so on for "length" bytes; the rest of the
+// last page is zero, and is never written back.
+
+class MappedFile {
+  public:
+    MappedFile(OpenFile *f, int off, int len, int first) {
+	file = f; offset = off; length = len; firstPage = first;
+	numPages = divRoundUp(len, PageSize);
+    }
+    ~MappedFile() { delete file; }	// close our own open of the file
+
+    bool Contains(int vpn)		// Is page "vpn" part of the mapping?
+	{ return vpn >= firstPage && vpn < firstPage + numPages; }
+    int Position(int vpn)		// Where page "vpn" is in the file
+	{ return offset + (vpn - firstPage) * PageSize; }
+    int Bytes(int vpn)			// How much of the file it holds
+	{ return min(PageSize, length - (vpn - firstPage) * PageSize); }
+
+    OpenFile *file;			// The file; closed with the mapping
+    int offset;				// Byte of the file mapped first
+    int length;				// Bytes mapped
+    int firstPage;			// Virtual page they start at
+    int numPages;			// Pages they take up
+};
+
+class AddrSpace : public PageOwner {
   public:
     AddrSpace();			// Create an address space.
     ~AddrSpace();			// De-allocate an address space
@@ -39,15 +80,83 @@ class AddrSpace {
     // is 0 for Read, 1 for Write.
     ExceptionType Translate(unsigned int vaddr, unsigned int *paddr, int mode);
 
+    bool ValidRange(int vaddr, int numBytes, bool writing);
+					// Is all of "numBytes" bytes at
+					// "vaddr" in the address space, and
+					// writable if "writing"?
+    bool CopyIn(int vaddr, char *into, int numBytes);
+					// Copy user memory at "vaddr" into
+					// a kernel buffer; FALSE if any of
+					// it isn't mapped
+    bool CopyOut(char *from, int vaddr, int numBytes);
+					// Copy a kernel buffer out to user
+					// memory; FALSE if any of it isn't
+					// mapped writable
+    int CopyInString(int vaddr, char *into, int maxBytes);
+					// Copy in a null-terminated string
+					// of at most "maxBytes" bytes,
+					// terminator included; return its
+					// length, or -1 if it is too long
+					// or isn't mapped
+
+    bool PageIn(int vpn);		// Bring virtual page "vpn" into a
+					// frame, on a page fault; FALSE if
+					// there is no such page
+    void PageOut(int vpn);		// Save page "vpn" to swap (or its
+					// file) and give up its frame; called
+					// by the frame table when it needs it
+    bool CopyOnWrite(unsigned int vpn);	// Give page "vpn" a private copy,
+					// on a write to it; FALSE if it
+					// isn't copy on write
+    void DropPage(int vpn);		// Take page "vpn" out of the
+					// page table
+    bool MapsShared(int vpn, int frame);
+					// Is page "vpn" mapped to "frame"
+					// of the image?
+    bool TestAndClearUse(int vpn);	// Was page "vpn" used since the
+					// last call?  Called by the frame
+					// table's clock
+    bool RefillTlb(unsigned int vpn);	// Load page "vpn" into the TLB, on
+					// a TLB miss; FALSE if there is no
+					// such page
+
+    int Mmap(OpenFile *file, int offset, int length);
+					// Map "length" bytes of "file" from
+					// "offset" on; return the address
+					// they are mapped at, or -1
+    bool Munmap(int vaddr);		// Write back and remove the mapping
+					// at "vaddr"; FALSE if there is none
+
+    FileDescriptorTable *FileTable() { return fileTable; }
+					// Files opened by this program
+
   private:
     TranslationEntry *pageTable;	// Assume linear page table translation
 					// for now!
     unsigned int numPages;		// Number of pages in the virtual 
 					// address space
+    unsigned int programPages;		// How many of them are the program's
+					// own: code, data and stack.  Mapped
+					// files come after
+    List<MappedFile *> *mappings;	// Files mapped into the space
+    FileDescriptorTable *fileTable;	// Descriptors of the open files
 
+    Image *image;			// Pages from the executable, shared
+					// with other address spaces
+    bool *shared;			// For each page, whether it is still
+					// the image's, mapped copy on write
+    int *swapSlot;			// Swap slot holding each page,
+					// or -1 if it was never paged out
     void InitRegisters();		// Initialize user-level CPU registers,
 					// before jumping to user code
 
+    MappedFile *FindMapping(int vpn);	// The mapping page "vpn" is in, if any
+    void Grow(unsigned int newNumPages);
+					// Make room for more pages
+    void WriteBack(MappedFile *mapping, int vpn);
+					// Write page "vpn" back to its file
+    void Unmap(MappedFile *mapping);	// Write back and remove "mapping"
+
 };
 
 #endif // ADDRSPACE_H
@@ -4,8 +4,11 @@
 //	transfer back to here from user code:
 //
 //	syscall -- The user code explicitly requests to call a procedure
-//	in the Nachos kernel.  Right now, the only function we support is
-//	"Halt".
+//	in the Nachos kernel.  The system calls are listed in a table,
+//	indexed by system call code, that says how many arguments each
+//	takes and whether it returns a value; ExceptionHandler looks the
+//	call up, runs its handler, and returns to the user program
+//	through one common path.
 //
 //	exceptions -- The user code does something that the CPU can't handle.
 //	For instance, accessing memory that doesn't exist, arithmetic errors,
@@ -14,9 +17,6 @@
 //	Interrupts (which can also cause control to transfer from user
 //	code into the Nachos kernel) are handled elsewhere.
 //
-// For now, this only handles the Halt() system call.
-// Everything else core dumps.
-//
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
@@ -25,6 +25,384 @@
 #include "main.h"
 #include "syscall.h"
 #include "ksyscall.h"
+#include <sstream>
+#include <limits.h>
+
+#define MaxStringLen	256	// longest file name or message a
+				// user program can pass in
+
+//----------------------------------------------------------------------
+// CurrentSpace
+// 	The address space of the user program making the system call.
+//	User pointers are always copied through it (CopyIn, CopyOut,
+//	CopyInString), never used to index main memory directly.
+//----------------------------------------------------------------------
+
+static AddrSpace *
+CurrentSpace()
+{
+    return kernel->currentThread->space;
+}
+
+//----------------------------------------------------------------------
+// FetchIoVec
+// 	Copy the IoVec array of a ReadV/WriteV call in from user memory,
+//	and set up one kernel buffer big enough for all of its buffers,
+//	so the whole call is a single file access.  "buffers" is filled
+//	in with where each user buffer goes in it.  Return the kernel
+//	buffer, for the caller to delete, or NULL if "count" is out of
+//	range, the array isn't mapped, or a buffer isn't in the address
+//	space (or isn't writable, for "writing").  Each buffer fits in
+//	the address space, so checking that the sum fits in an int is
+//	enough to bound the kernel buffer.
+//
+//	"addr" -- the user address of the array
+//	"count" -- the number of entries in it
+//	"writing" -- will the buffers be written, for ReadV?
+//	"bases", "sizes" -- filled in with the user buffers
+//	"total" -- filled in with the size of the kernel buffer
+//----------------------------------------------------------------------
+
+static char *
+FetchIoVec(int addr, int count, bool writing, int *bases, int *sizes,
+	   char **buffers, int *total)
+{
+    int iov[2 * MaxIoVec];
+    char *kernelBuf;
+
+    if (count < 0 || count > MaxIoVec)
+	return NULL;
+    if (!CurrentSpace()->CopyIn(addr, (char *) iov, count * sizeof(IoVec)))
+	return NULL;
+    *total = 0;
+    for (int i = 0; i < count; i++) {
+	bases[i] = WordToHost(iov[2 * i]);
+	sizes[i] = WordToHost(iov[2 * i + 1]);
+	if (!CurrentSpace()->ValidRange(bases[i], sizes[i], writing)
+	    || *total > INT_MAX - sizes[i])
+	    return NULL;
+	*total += sizes[i];
+    }
+    kernelBuf = new char[*total + 1];	// never a zero-length array
+    for (int i = 0, offset = 0; i < count; offset += sizes[i++])
+	buffers[i] = kernelBuf + offset;
+    return kernelBuf;
+}
+
+//----------------------------------------------------------------------
+// System call handlers
+// 	Each handler is given the system call's arguments, already read
+//	out of registers r4 onward, and returns the value for r2 (ignored
+//	for calls that don't return one).  User pointers among the
+//	arguments are copied through the address space by the handler.
+//----------------------------------------------------------------------
+
+static int
+DoHalt(int *)
+{
+    DEBUG(dbgSys, "Shutdown, initiated by user program.\n");
+    SysHalt();
+    ASSERTNOTREACHED();
+    return 0;
+}
+
+static int
+DoExit(int *arg)
+{
+    DEBUG(dbgAddr, "Program exit\n");
+    cout << "return value:" << arg[0] << endl;
+    kernel->currentThread->Finish();
+    ASSERTNOTREACHED();
+    return 0;
+}
+
+static int
+DoMsg(int *arg)
+{
+    char msg[MaxStringLen];
+
+    DEBUG(dbgSys, "Message received.\n");
+    if (CurrentSpace()->CopyInString(arg[0], msg, MaxStringLen) >= 0)
+	cout << msg << endl;
+    SysHalt();
+    ASSERTNOTREACHED();
+    return 0;
+}
+
+static int
+DoPrintInt(int *arg)
+{
+    SysPrintInt(arg[0]);
+    return 0;
+}
+
+static int
+DoAdd(int *arg)
+{
+    int result;
+
+    DEBUG(dbgSys, "Add " << arg[0] << " + " << arg[1] << "\n");
+    result = SysAdd(arg[0], arg[1]);
+    DEBUG(dbgSys, "Add returning with " << result << "\n");
+    cout << "result is " << result << "\n";
+    return result;
+}
+
+static int
+DoCreate(int *arg)
+{
+    char filename[MaxStringLen];
+
+    if (CurrentSpace()->CopyInString(arg[0], filename, MaxStringLen) < 0)
+	return -1;
+    return SysCreate(filename, arg[1]);
+}
+
+static int
+DoRemove(int *arg)
+{
+    char filename[MaxStringLen];
+
+    if (CurrentSpace()->CopyInString(arg[0], filename, MaxStringLen) < 0)
+	return 0;
+    return SysRemove(filename);
+}
+
+static int
+DoOpen(int *arg)
+{
+    char filename[MaxStringLen];
+
+    if (CurrentSpace()->CopyInString(arg[0], filename, MaxStringLen) < 0)
+	return -1;
+    return SysOpen(filename);
+}
+
+static int
+DoClose(int *arg)
+{
+    return SysClose(arg[0]);
+}
+
+static int
+DoMmap(int *arg)
+{
+    return SysMmap(arg[0], arg[1], arg[2]);
+}
+
+static int
+DoMunmap(int *arg)
+{
+    return SysMunmap(arg[0]);
+}
+
+static int
+DoSeek(int *arg)
+{
+    return SysSeek(arg[0], arg[1]);
+}
+
+// Write(buffer, size, fd) and PWrite(buffer, size, position, fd).
+// The buffer is checked against the address space before a kernel
+// buffer of its size is allocated.
+
+static int
+DoWrite(int *arg, bool positional)
+{
+    int size = arg[1];
+    char *buffer;
+
+    if (!CurrentSpace()->ValidRange(arg[0], size, FALSE))
+	return -1;
+    buffer = new char[size + 1];
+    if (!CurrentSpace()->CopyIn(arg[0], buffer, size))
+	size = -1;
+    else if (positional)
+	size = SysPWrite(buffer, size, arg[2], arg[3]);
+    else
+	size = SysWrite(buffer, size, arg[2]);
+    delete [] buffer;
+    return size;
+}
+
+// Read(buffer, size, fd) and PRead(buffer, size, position, fd).
+// The buffer must be in the address space and writable before any
+// data is taken from the file.
+
+static int
+DoRead(int *arg, bool positional)
+{
+    int size = arg[1];
+    char *buffer;
+
+    if (!CurrentSpace()->ValidRange(arg[0], size, TRUE))
+	return -1;
+    buffer = new char[size + 1];
+    if (positional)
+	size = SysPRead(buffer, size, arg[2], arg[3]);
+    else
+	size = SysRead(buffer, size, arg[2]);
+    if (size > 0 && !CurrentSpace()->CopyOut(buffer, arg[0], size))
+	size = -1;
+    delete [] buffer;
+    return size;
+}
+
+static int DoWrite(int *arg) { return DoWrite(arg, FALSE); }
+static int DoPWrite(int *arg) { return DoWrite(arg, TRUE); }
+static int DoRead(int *arg) { return DoRead(arg, FALSE); }
+static int DoPRead(int *arg) { return DoRead(arg, TRUE); }
+
+static int
+DoWriteV(int *arg)
+{
+    char *buffers[MaxIoVec];
+    int bases[MaxIoVec], sizes[MaxIoVec];
+    int count = arg[1], total, result, i;
+    char *kernelBuf = FetchIoVec(arg[0], count, FALSE, bases, sizes,
+				 buffers, &total);
+
+    if (kernelBuf == NULL)
+	return -1;
+    for (i = 0; i < count; i++)
+	if (!CurrentSpace()->CopyIn(bases[i], buffers[i], sizes[i]))
+	    break;
+    if (i < count)
+	result = -1;
+    else
+	result = SysWrite(kernelBuf, total, arg[2]);
+    delete [] kernelBuf;
+    return result;
+}
+
+static int
+DoReadV(int *arg)
+{
+    char *buffers[MaxIoVec];
+    int bases[MaxIoVec], sizes[MaxIoVec];
+    int count = arg[1], total, result, left, n, i;
+    char *kernelBuf = FetchIoVec(arg[0], count, TRUE, bases, sizes,
+				 buffers, &total);
+
+    if (kernelBuf == NULL)
+	return -1;
+    result = SysRead(kernelBuf, total, arg[2]);
+    for (i = 0, left = result; i < count && left > 0; i++, left -= n) {
+	n = min(sizes[i], left);
+	if (!CurrentSpace()->CopyOut(buffers[i], bases[i], n)) {
+	    result = -1;
+	    break;
+	}
+    }
+    delete [] kernelBuf;
+    return result;
+}
+
+//----------------------------------------------------------------------
+// The system call table
+// 	One entry per system call: its code, its name (for statistics
+//	and tracing), how many arguments to pass the handler, and whether
+//	the handler's result goes back to the user program in r2.
+//	Calls that never return (Halt, Exit, MSG) are accounted for
+//	before they run.  To add a system call, give it a code in
+//	syscall.h, a stub in start.S, and an entry here.
+//----------------------------------------------------------------------
+
+class SyscallEntry {
+  public:
+    int code;				// SC_* code
+    const char *name;			// for statistics
+    int numArgs;			// arguments, from r4 on
+    bool returnsValue;			// result goes in r2
+    bool returns;			// comes back to the user program
+    int (*handler)(int *arg);		// does the work
+};
+
+static const SyscallEntry syscallList[] = {
+    { SC_Halt,     "Halt",     0, FALSE, FALSE, DoHalt },
+    { SC_Exit,     "Exit",     1, FALSE, FALSE, DoExit },
+    { SC_MSG,      "MSG",      1, FALSE, FALSE, DoMsg },
+    { SC_PrintInt, "PrintInt", 1, FALSE, TRUE,  DoPrintInt },
+    { SC_Add,      "Add",      2, TRUE,  TRUE,  DoAdd },
+    { SC_Create,   "Create",   2, TRUE,  TRUE,  DoCreate },
+    { SC_Remove,   "Remove",   1, TRUE,  TRUE,  DoRemove },
+    { SC_Open,     "Open",     1, TRUE,  TRUE,  DoOpen },
+    { SC_Read,     "Read",     3, TRUE,  TRUE,  DoRead },
+    { SC_Write,    "Write",    3, TRUE,  TRUE,  DoWrite },
+    { SC_Seek,     "Seek",     2, TRUE,  TRUE,  DoSeek },
+    { SC_Close,    "Close",    1, TRUE,  TRUE,  DoClose },
+    { SC_ReadV,    "ReadV",    3, TRUE,  TRUE,  DoReadV },
+    { SC_WriteV,   "WriteV",   3, TRUE,  TRUE,  DoWriteV },
+    { SC_PRead,    "PRead",    4, TRUE,  TRUE,  DoPRead },
+    { SC_PWrite,   "PWrite",   4, TRUE,  TRUE,  DoPWrite },
+    { SC_Mmap,     "Mmap",     3, TRUE,  TRUE,  DoMmap },
+    { SC_Munmap,   "Munmap",   1, TRUE,  TRUE,  DoMunmap },
+};
+
+static const SyscallEntry *syscallTable[NumSyscallCodes];
+
+//----------------------------------------------------------------------
+// LookupSyscall
+// 	Return the table entry for system call "type", or NULL if there
+//	is no such call.  The table is indexed by code, built from
+//	syscallList the first time through.
+//----------------------------------------------------------------------
+
+static const SyscallEntry *
+LookupSyscall(int type)
+{
+    static bool initialized = FALSE;
+
+    if (!initialized) {
+	for (unsigned i = 0; i < sizeof(syscallList) / sizeof(syscallList[0]); i++) {
+	    ASSERT(syscallList[i].code >= 0 && syscallList[i].code < NumSyscallCodes);
+	    ASSERT(syscallList[i].numArgs <= 4);
+	    syscallTable[syscallList[i].code] = &syscallList[i];
+	}
+	initialized = TRUE;
+    }
+    if (type < 0 || type >= NumSyscallCodes)
+	return NULL;
+    return syscallTable[type];
+}
+
+//----------------------------------------------------------------------
+// TraceArgs
+// 	Format the arguments of a system call for the dbgTrace log, as
+//	"(a, b, c)".
+//----------------------------------------------------------------------
+
+static string
+TraceArgs(int numArgs, int *arg)
+{
+    ostringstream out;
+
+    out << "(";
+    for (int i = 0; i < numArgs; i++)
+	out << (i > 0 ? ", " : "") << arg[i];
+    out << ")";
+    return out.str();
+}
+
+//----------------------------------------------------------------------
+// AdvancePC
+// 	Move the program counter past the syscall instruction, so the
+//	user program doesn't make the same system call forever.
+//----------------------------------------------------------------------
+
+static void
+AdvancePC()
+{
+    /* set previous programm counter (debugging only)*/
+    kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+
+    /* set programm counter to next instruction (all Instructions are 4 byte wide)*/
+    kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+
+    /* set next programm counter for brach execution */
+    kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
+}
+
 //----------------------------------------------------------------------
 // ExceptionHandler
 // 	Entry point into the Nachos kernel.  Called when a user program
@@ -52,147 +430,62 @@ void
 ExceptionHandler(ExceptionType which)
 {
     int type = kernel->machine->ReadRegister(2);
-	int val;
-    int status, exit, threadID, programID;
-	int size, fd;
-	DEBUG(dbgSys, "Received Exception " << which << " type: " << type << "\n");
+    const SyscallEntry *call;
+    int arg[4];
+    int result, startTicks, vpn;
+    long long startNs;
+
+    DEBUG(dbgSys, "Received Exception " << which << " type: " << type << "\n");
     switch (which) {
     case SyscallException:
-      	switch(type) {
-      	case SC_Halt:
-			DEBUG(dbgSys, "Shutdown, initiated by user program.\n");
-			SysHalt();
-                        cout<<"in exception\n";
-			ASSERTNOTREACHED();
-			break;
-		case SC_MSG:
-			DEBUG(dbgSys, "Message received.\n");
-			val = kernel->machine->ReadRegister(4);
-			{
-			char *msg = &(kernel->machine->mainMemory[val]);
-			cout << msg << endl;
-			}
-			SysHalt();
-			ASSERTNOTREACHED();
-			break;
-		case SC_PrintInt:
-			val = kernel->machine->ReadRegister(4);
-			SysPrintInt(val);
-	  		kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
-	  		kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
-	 		kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
-			return;
-		case SC_Create:
-			val = kernel->machine->ReadRegister(4);
-			{
-			char *filename = &(kernel->machine->mainMemory[val]);
-			size = kernel->machine->ReadRegister(5);
-			//cout << filename << endl;
-			status = SysCreate(filename, size);
-			kernel->machine->WriteRegister(2, (int) status);
-			}
-			kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
-			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
-			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
-			return;
-			ASSERTNOTREACHED();
-            break;
-		case SC_Open:
-			val = kernel->machine->ReadRegister(4);
-			{
-				char *filename = &(kernel->machine->mainMemory[val]);
-				//cout << filename << endl;
-				fd = SysOpen(filename);
-				kernel->machine->WriteRegister(2, (int) fd);
-			}
-			kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
-			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
-			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
-			return;
-			ASSERTNOTREACHED();
-            break;
-		case SC_Write:
-			val = kernel->machine->ReadRegister(4);
-			size = kernel->machine->ReadRegister(5);
-			fd = kernel->machine->ReadRegister(6);
-			{
-				char *buffer = &(kernel->machine->mainMemory[val]);
-				size = SysWrite(buffer, size, fd);
-				kernel->machine->WriteRegister(2, (int) size);
-			}
-			kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
-			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
-			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
-			return;
-			ASSERTNOTREACHED();
-            break;
-		case SC_Close:
-			fd = kernel->machine->ReadRegister(4);
-			{
-				val = SysClose(fd);
-				kernel->machine->WriteRegister(2, (int) val);
-			}
-			kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
-			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
-			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
-			return;
-			ASSERTNOTREACHED();
-            break;
-		case SC_Read:
-			val = kernel->machine->ReadRegister(4);
-			size = kernel->machine->ReadRegister(5);
-			fd = kernel->machine->ReadRegister(6);
-			{
-				char *buffer = &(kernel->machine->mainMemory[val]);
-				size = SysRead(buffer, size, fd);
-				kernel->machine->WriteRegister(2, (int) size);
-			}
-			kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
-			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
-			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
-			return;
-			ASSERTNOTREACHED();
-            break;
-
-      	case SC_Add:
-			DEBUG(dbgSys, "Add " << kernel->machine->ReadRegister(4) << " + " << kernel->machine->ReadRegister(5) << "\n");
-			/* Process SysAdd Systemcall*/
-			int result;
-			result = SysAdd(/* int op1 */(int)kernel->machine->ReadRegister(4),
-			/* int op2 */(int)kernel->machine->ReadRegister(5));
-			DEBUG(dbgSys, "Add returning with " << result << "\n");
-			/* Prepare Result */
-			kernel->machine->WriteRegister(2, (int)result);	
-			/* Modify return point */
-			{
-	  		/* set previous programm counter (debugging only)*/
-	  		kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
-	  			
-			/* set programm counter to next instruction (all Instructions are 4 byte wide)*/
-	  		kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
-	  
-	 		/* set next programm counter for brach execution */
-	 		kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg)+4);
-			}
-			cout << "result is " << result << "\n";	
-			return;	
-			ASSERTNOTREACHED();
-            break;
-		case SC_Exit:
-			DEBUG(dbgAddr, "Program exit\n");
-            val=kernel->machine->ReadRegister(4);
-            cout << "return value:" << val << endl;
-			kernel->currentThread->Finish();
-            break;
-      	default:
-			cerr << "Unexpected system call " << type << "\n";
-			break;
-		}
-		break;
-	default:
-		cerr << "Unexpected user mode exception " << (int)which << "\n";
-		break;
+	call = LookupSyscall(type);
+	if (call == NULL) {
+	    cerr << "Unexpected system call " << type << "\n";
+	    break;
+	}
+	for (int i = 0; i < call->numArgs; i++)
+	    arg[i] = kernel->machine->ReadRegister(4 + i);
+	if (!call->returns) {
+	    DEBUG(dbgTrace, "[" << kernel->stats->totalTicks << "] " << call->name
+		  << TraceArgs(call->numArgs, arg));
+	    kernel->stats->RecordSyscall(type, call->name, 0, 0);
+	}
+	startTicks = kernel->stats->totalTicks;
+	startNs = HostNanoseconds();
+	result = (*call->handler)(arg);
+	kernel->stats->RecordSyscall(type, call->name,
+				     kernel->stats->totalTicks - startTicks,
+				     HostNanoseconds() - startNs);
+	DEBUG(dbgTrace, "[" << startTicks << "] " << call->name
+	      << TraceArgs(call->numArgs, arg) << " = " << result << ", "
+	      << kernel->stats->totalTicks - startTicks << " ticks");
+	if (call->returnsValue)
+	    kernel->machine->WriteRegister(2, result);
+	AdvancePC();
+	return;
+    case PageFaultException:
+	vpn = (unsigned) kernel->machine->ReadRegister(BadVAddrReg) / PageSize;
+	if (kernel->tlbManager == NULL) {
+	    DEBUG(dbgAddr, "Page fault on page " << vpn);
+	    if (CurrentSpace()->PageIn(vpn))
+		return;			// and try the instruction again
+	} else {
+	    DEBUG(dbgAddr, "TLB miss on page " << vpn);
+	    if (CurrentSpace()->RefillTlb(vpn))
+		return;			// likewise
+	}
+	cerr << "Address error on page " << vpn << "\n";
+	break;
+    case ReadOnlyException:
+	vpn = (unsigned) kernel->machine->ReadRegister(BadVAddrReg) / PageSize;
+	DEBUG(dbgAddr, "Write to read-only page " << vpn);
+	if (CurrentSpace()->CopyOnWrite(vpn))
+	    return;			// try the write again
+	cerr << "Write to read-only page " << vpn << "\n";
+	break;
+    default:
+	cerr << "Unexpected user mode exception " << (int)which << "\n";
+	break;
     }
     ASSERTNOTREACHED();
 }
-
@@ -0,0 +1,117 @@
+// frametable.cc 
+//	Routines to hand out the physical page frames of the simulated
+//	machine to address spaces, and take them back.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "frametable.h"
+#include "debug.h"
+#include "main.h"
+
+//----------------------------------------------------------------------
+// FrameTable::FrameTable
+// 	Initialize a frame table with every frame free.
+//
+//	"numFrames" -- the number of frames of main memory
+//----------------------------------------------------------------------
+
+FrameTable::FrameTable(int numFrames)
+{
+    this->numFrames = numFrames;
+    freeFrames = new Bitmap(numFrames);
+    owner = new PageOwner *[numFrames];
+    ownerPage = new int[numFrames];
+    for (int i = 0; i < numFrames; i++) {
+	owner[i] = NULL;
+	ownerPage[i] = -1;
+    }
+    hand = 0;
+    lock = new Lock((char *) "frame table");
+}
+
+//----------------------------------------------------------------------
+// FrameTable::~FrameTable
+// 	De-allocate the frame table.
+//----------------------------------------------------------------------
+
+FrameTable::~FrameTable()
+{
+    delete freeFrames;
+    delete [] owner;
+    delete [] ownerPage;
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Allocate
+// 	Find a frame to hold page "page" of "pageOwner".  If every frame
+//	is in use, the page in the one Victim picks is paged out by its
+//	owner, and the frame reused.
+//
+//	The caller must hold the frame table lock.
+//
+//	"pageOwner" -- the address space (or image) the page belongs to
+//	"page" -- the page that will live in the frame
+//----------------------------------------------------------------------
+
+int
+FrameTable::Allocate(PageOwner *pageOwner, int page)
+{
+    int frame;
+
+    ASSERT(lock->IsHeldByCurrentThread());
+    frame = freeFrames->FindAndSet();
+    if (frame == -1) {
+	frame = Victim();
+	DEBUG(dbgAddr, "Evicting frame " << frame << ", page " 
+	      << ownerPage[frame]);
+	owner[frame]->PageOut(ownerPage[frame]);
+	kernel->stats->numEvictions++;
+    }
+    owner[frame] = pageOwner;
+    ownerPage[frame] = page;
+    return frame;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Free
+// 	Give back a frame whose page is no longer needed.
+//
+//	"frame" -- a frame returned by Allocate
+//----------------------------------------------------------------------
+
+void
+FrameTable::Free(int frame)
+{
+    ASSERT(freeFrames->Test(frame));
+    freeFrames->Clear(frame);
+    owner[frame] = NULL;
+    ownerPage[frame] = -1;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Victim
+// 	Pick the frame whose page is to be evicted, by the clock
+//	algorithm.  Starting at the hand, each page that was used since
+//	the hand last passed it has its use bit cleared and is skipped;
+//	the first one that wasn't is the victim.  Every frame is in use,
+//	so this stops within two sweeps of the frames.
+//
+//	The caller must hold the frame table lock.
+//----------------------------------------------------------------------
+
+int
+FrameTable::Victim()
+{
+    int frame;
+
+    for (;;) {
+	frame = hand;
+	hand = (hand + 1) % numFrames;
+	if (!owner[frame]->TestAndClearUse(ownerPage[frame]))
+	    return frame;
+    }
+}
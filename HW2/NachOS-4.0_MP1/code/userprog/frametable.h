@@ -0,0 +1,60 @@
+// frametable.h 
+//	Data structures to manage the physical page frames of the
+//	simulated machine.
+//
+//	Address spaces don't own a fixed piece of main memory; each page
+//	of a user program is given a frame from the one frame table the
+//	first time it is touched.  The table remembers which page of which
+//	address space (or shared image) is in each frame, so that when every frame is in use
+//	it can pick a victim and have its address space page it out.
+//
+//	Victims are picked by the clock (second chance) algorithm: a hand
+//	sweeps the frames, and a page whose use bit is set has the bit
+//	cleared and is passed over once; the first page found unused since
+//	the hand last went by is evicted.  Only dirty pages are written to
+//	swap; a clean one still has a good copy in swap or the executable.
+//
+//	Paging waits for the disk, so it is done holding the frame table's
+//	lock: a frame being filled or emptied is never handed to anyone
+//	else half way.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#ifndef FRAMETABLE_H
+#define FRAMETABLE_H
+
+#include "copyright.h"
+#include "bitmap.h"
+#include "synch.h"
+#include "pageowner.h"
+
+class FrameTable {
+  public:
+    FrameTable(int numFrames);		// Initialize with every frame free
+    ~FrameTable();			// De-allocate the table
+
+    void Acquire() { lock->Acquire(); }	// Paging is done holding
+    void Release() { lock->Release(); }	// the frame table lock
+
+    int Allocate(PageOwner *owner, int page);
+					// Find a frame for page "page" of
+					// "owner", evicting some other page
+					// if memory is full
+    void Free(int frame);		// Give a frame back
+
+    int NumFree() { return freeFrames->NumClear(); }
+
+  private:
+    int Victim();			// Pick the frame to evict
+
+    int numFrames;			// frames of main memory
+    Bitmap *freeFrames;			// which frames are in use
+    PageOwner **owner;			// for each frame, who it belongs to
+    int *ownerPage;			// and which of its pages is there
+    int hand;				// next frame the clock looks at
+    Lock *lock;				// held while paging
+};
+
+#endif // FRAMETABLE_H
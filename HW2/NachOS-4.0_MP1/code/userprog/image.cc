@@ -0,0 +1,421 @@
+// image.cc 
+//	Routines to share the pages of an executable between the address
+//	spaces running it.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "image.h"
+#include "addrspace.h"
+#include "main.h"
+#include "debug.h"
+
+//----------------------------------------------------------------------
+// SwapHeader
+// 	Do little endian to big endian conversion on the bytes in the 
+//	object file header, in case the file was generated on a little
+//	endian machine, and we're now running on a big endian machine.
+//----------------------------------------------------------------------
+
+static void 
+SwapHeader (NoffHeader *noffH)
+{
+    noffH->noffMagic = WordToHost(noffH->noffMagic);
+    noffH->code.size = WordToHost(noffH->code.size);
+    noffH->code.virtualAddr = WordToHost(noffH->code.virtualAddr);
+    noffH->code.inFileAddr = WordToHost(noffH->code.inFileAddr);
+#ifdef RDATA
+    noffH->readonlyData.size = WordToHost(noffH->readonlyData.size);
+    noffH->readonlyData.virtualAddr = 
+           WordToHost(noffH->readonlyData.virtualAddr);
+    noffH->readonlyData.inFileAddr = 
+           WordToHost(noffH->readonlyData.inFileAddr);
+#endif 
+    noffH->initData.size = WordToHost(noffH->initData.size);
+    noffH->initData.virtualAddr = WordToHost(noffH->initData.virtualAddr);
+    noffH->initData.inFileAddr = WordToHost(noffH->initData.inFileAddr);
+    noffH->uninitData.size = WordToHost(noffH->uninitData.size);
+    noffH->uninitData.virtualAddr = WordToHost(noffH->uninitData.virtualAddr);
+    noffH->uninitData.inFileAddr = WordToHost(noffH->uninitData.inFileAddr);
+
+#ifdef RDATA
+    DEBUG(dbgAddr, "code = " << noffH->code.size <<  
+                   " readonly = " << noffH->readonlyData.size <<
+                   " init = " << noffH->initData.size <<
+                   " uninit = " << noffH->uninitData.size << "\n");
+#endif
+}
+
+//----------------------------------------------------------------------
+// Image::Image
+// 	Set up the image of an executable, with none of its pages in
+//	memory yet.  Assumes that the object code file is in NOFF format.
+//	The header is read through the window, so the start of the code
+//	comes in along with it.
+//
+//	"fileName" -- the name the executable was opened by
+//	"file" -- the executable, open; the image closes it when done
+//----------------------------------------------------------------------
+
+Image::Image(char *fileName, OpenFile *file)
+{
+    int end = 0;
+
+    executable = file;
+    name = new char[strlen(fileName) + 1];
+    strcpy(name, fileName);
+    window = new char[WindowSize];
+    windowStart = windowLength = 0;
+    ReadExecutable((char *)&noffH, sizeof(noffH), 0);
+    if ((noffH.noffMagic != NOFFMAGIC) && 
+		(WordToHost(noffH.noffMagic) == NOFFMAGIC))
+    	SwapHeader(&noffH);
+    ASSERT(noffH.noffMagic == NOFFMAGIC);
+
+    numExtents = 0;
+    AddExtent(&noffH.code);
+#ifdef RDATA
+    AddExtent(&noffH.readonlyData);
+#endif
+    AddExtent(&noffH.initData);
+
+// the image is every page something is read into from the executable
+    for (int i = 0; i < numExtents; i++)
+	end = max(end, extent[i].virtualAddr + extent[i].size);
+    numPages = divRoundUp(end, PageSize);
+    DEBUG(dbgAddr, "Image of " << name << ": " << numPages << " pages, " << numExtents << " extents");
+
+    sector = executable->Sector();
+    frame = new int[numPages];
+    for (int i = 0; i < numPages; i++)
+	frame[i] = -1;
+    users = new List<AddrSpace *>();
+}
+
+//----------------------------------------------------------------------
+// Image::~Image
+// 	Give back the frames holding pages of the image, and close the
+//	executable.  Nobody may be using the image any more.
+//
+//	The caller must hold the frame table lock.
+//----------------------------------------------------------------------
+
+Image::~Image()
+{
+    ASSERT(users->IsEmpty());
+    for (int i = 0; i < numPages; i++) {
+	if (frame[i] != -1)
+	    kernel->frameTable->Free(frame[i]);
+    }
+    delete [] frame;
+    delete users;
+    delete [] window;
+    delete [] name;
+    delete executable;
+}
+
+//----------------------------------------------------------------------
+// Image::GetPage
+// 	Return the frame holding page "vpn" of the image.  If the page
+//	isn't in memory, find it a frame and read it from the executable.
+//
+//	The caller must hold the frame table lock.
+//
+//	"vpn" -- a page of the image
+//----------------------------------------------------------------------
+
+int
+Image::GetPage(int vpn)
+{
+    int f;
+
+    ASSERT(vpn >= 0 && vpn < numPages);
+    if (frame[vpn] == -1) {
+	f = kernel->frameTable->Allocate(this, vpn);
+	DEBUG(dbgAddr, "Image page " << vpn << " in from the executable");
+	LoadPage(vpn, &kernel->machine->mainMemory[f * PageSize]);
+	kernel->machine->InvalidateCode(f);
+	frame[vpn] = f;
+    }
+    return frame[vpn];
+}
+
+//----------------------------------------------------------------------
+// Image::TestAndClearUse
+// 	Return whether any address space used page "vpn" of the image
+//	since the last time this was called on it, and clear the use
+//	bit in each of them.
+//
+//	Called by the frame table, which holds its lock.
+//
+//	"vpn" -- a page of the image that is in memory
+//----------------------------------------------------------------------
+
+bool
+Image::TestAndClearUse(int vpn)
+{
+    ListIterator<AddrSpace *> iter(users);
+    bool used = FALSE;
+
+    for (; !iter.IsDone(); iter.Next()) {
+	if (iter.Item()->MapsShared(vpn, frame[vpn]) 
+		&& iter.Item()->TestAndClearUse(vpn))
+	    used = TRUE;
+    }
+    return used;
+}
+
+//----------------------------------------------------------------------
+// Image::PageOut
+// 	Take page "vpn" of the image out of memory, so that the frame
+//	table can give its frame to another page.  The page is taken out
+//	of every address space that maps it; it is never dirty, so there
+//	is nothing to write back.
+//
+//	Called by the frame table, which holds its lock.
+//
+//	"vpn" -- a page of the image that is in memory
+//----------------------------------------------------------------------
+
+void
+Image::PageOut(int vpn)
+{
+    ListIterator<AddrSpace *> iter(users);
+
+    DEBUG(dbgAddr, "Image page " << vpn << " dropped");
+    for (; !iter.IsDone(); iter.Next()) {
+	if (iter.Item()->MapsShared(vpn, frame[vpn]))
+	    iter.Item()->DropPage(vpn);
+    }
+    frame[vpn] = -1;
+}
+
+//----------------------------------------------------------------------
+// Image::AddExtent
+// 	Add segment "seg" of the executable to the extents.  If it
+//	carries on where the last extent stops, both in the file and in
+//	the address space, that extent just gets longer.  Empty segments
+//	are left out.
+//----------------------------------------------------------------------
+
+void
+Image::AddExtent(Segment *seg)
+{
+    Extent *last;
+
+    if (seg->size <= 0)
+	return;
+    last = (numExtents > 0) ? &extent[numExtents - 1] : NULL;
+    if (last != NULL && last->virtualAddr + last->size == seg->virtualAddr
+		&& last->inFileAddr + last->size == seg->inFileAddr) {
+	last->size += seg->size;
+	return;
+    }
+    ASSERT(numExtents < MaxExtents);
+    extent[numExtents].virtualAddr = seg->virtualAddr;
+    extent[numExtents].inFileAddr = seg->inFileAddr;
+    extent[numExtents].size = seg->size;
+    numExtents++;
+}
+
+//----------------------------------------------------------------------
+// Image::LoadPage
+// 	Fill "into" with page "vpn" as the executable lays it out.  A
+//	page may hold the end of one extent and the start of the next;
+//	whatever no extent covers is zero.
+//
+//	"vpn" -- the page to load
+//	"into" -- the frame of main memory it goes in
+//----------------------------------------------------------------------
+
+void
+Image::LoadPage(int vpn, char *into)
+{
+    int pageStart = vpn * PageSize;
+    int start, end;
+
+    bzero(into, PageSize);
+    for (int i = 0; i < numExtents; i++) {
+	start = max(pageStart, extent[i].virtualAddr);
+	end = min(pageStart + PageSize, extent[i].virtualAddr + extent[i].size);
+	if (start < end)		// else the extent misses this page
+	    ReadExecutable(&into[start - pageStart], end - start,
+		extent[i].inFileAddr + (start - extent[i].virtualAddr));
+    }
+}
+
+//----------------------------------------------------------------------
+// Image::ReadExecutable
+// 	Copy "numBytes" bytes of the executable, from byte "position" on,
+//	into "into".  They are copied from the window if it holds them;
+//	if not, the window is moved to the sector they start in and
+//	refilled.  The window is whole sectors, starting on a sector
+//	boundary, so OpenFile::ReadAt reads it straight in with one disk
+//	request per run of consecutive sectors (usually just one) -- and
+//	it will usually hold the next few pages the program faults in as
+//	well.  Since the window is longer than a sector plus a page, the
+//	bytes wanted always fall inside it.
+//
+//	"into" -- where the bytes go
+//	"numBytes" -- how many; no more than a page
+//	"position" -- where they are in the executable
+//----------------------------------------------------------------------
+
+void
+Image::ReadExecutable(char *into, int numBytes, int position)
+{
+    int available;
+
+    ASSERT(numBytes <= PageSize);
+    if (position < windowStart 
+		|| position + numBytes > windowStart + windowLength) {
+	windowStart = divRoundDown(position, SectorSize) * SectorSize;
+	windowLength = max(executable->ReadAt(window, WindowSize, windowStart), 0);
+	DEBUG(dbgAddr, "Image window moved to " << windowStart << ", " << windowLength << " bytes");
+    }
+    available = min(numBytes, windowStart + windowLength - position);
+    if (available > 0)			// else past the end of the file
+	bcopy(&window[position - windowStart], into, available);
+}
+
+//----------------------------------------------------------------------
+// ImageKey, ImageHash
+// 	Key and hash functions for the image table: executables have
+//	distinct header sectors, so the sector number itself will do.
+//----------------------------------------------------------------------
+
+static int ImageKey(Image *image) { return image->Sector(); }
+
+static unsigned ImageHash(int sector) { return (unsigned) sector; }
+
+//----------------------------------------------------------------------
+// ImageCache::ImageCache
+// 	Initialize an empty table of images.
+//----------------------------------------------------------------------
+
+ImageCache::ImageCache()
+{
+    table = new HashTable<int, Image *>(ImageKey, ImageHash);
+}
+
+//----------------------------------------------------------------------
+// ImageCache::~ImageCache
+// 	De-allocate the table, and the images still used by programs
+//	that were blocked at the halt, giving back their frames and
+//	closing their executables.
+//----------------------------------------------------------------------
+
+ImageCache::~ImageCache()
+{
+    kernel->frameTable->Acquire();	// Image::~Image frees frames
+    while (!table->IsEmpty()) {
+	HashIterator<int, Image *> iter(table);
+	Image *image = iter.Item();
+
+	table->Remove(image->Sector());
+	while (!image->users->IsEmpty())
+	    image->users->RemoveFront();
+	delete image;
+    }
+    kernel->frameTable->Release();
+    delete table;
+}
+
+//----------------------------------------------------------------------
+// ImageCache::Get
+// 	Return the image of the executable "fileName", for address space
+//	"space" to run, or NULL if there is no such file.
+//
+//	If an image in use was loaded by the same name, it is shared
+//	without opening the file at all.  Otherwise the file is opened;
+//	if some address space is already running it under another name,
+//	its image is shared, and if not, a new image is made, which keeps
+//	the file open.  Either way, the image remembers "space", so a page
+//	can be taken out of every address space mapping it when it leaves
+//	memory.
+//
+//	Files that aren't on the Nachos disk (the stub file system) have
+//	no sector to tell them apart by, and are never shared.
+//
+//	"fileName" -- the program file
+//	"space" -- the address space the program is being loaded into
+//----------------------------------------------------------------------
+
+Image *
+ImageCache::Get(char *fileName, AddrSpace *space)
+{
+    OpenFile *executable;
+    Image *image, *other;
+
+    image = FindByName(fileName);
+    if (image != NULL) {
+	DEBUG(dbgAddr, "Sharing the image of " << fileName);
+    } else {
+	executable = kernel->fileSystem->Open(fileName);
+	if (executable == NULL)
+	    return NULL;
+	if (executable->Sector() != -1 
+		&& table->Find(executable->Sector(), &image)) {
+	    DEBUG(dbgAddr, "Sharing the image at sector " << image->Sector());
+	    delete executable;
+	} else {
+	    image = new Image(fileName, executable);
+	    // reading the header waited for the disk; someone else may
+	    // have loaded the same file meanwhile
+	    if (image->Sector() != -1 && table->Find(image->Sector(), &other)) {
+		delete image;
+		image = other;
+	    } else if (image->Sector() != -1) {
+		table->Insert(image);
+	    }
+	}
+    }
+    image->users->Append(space);
+    return image;
+}
+
+//----------------------------------------------------------------------
+// ImageCache::FindByName
+// 	Return the image in use that was loaded by "fileName", or NULL if
+//	there is none.  There are only ever a few images in use, so they
+//	are simply searched.
+//----------------------------------------------------------------------
+
+Image *
+ImageCache::FindByName(char *fileName)
+{
+    HashIterator<int, Image *> iter(table);
+
+    for (; !iter.IsDone(); iter.Next()) {
+	if (strcmp(iter.Item()->Name(), fileName) == 0)
+	    return iter.Item();
+    }
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// ImageCache::Put
+// 	Address space "space" is done with "image".  When no address
+//	space is running it any more, take it out of the table and
+//	de-allocate it.
+//
+//	The caller must hold the frame table lock, since the image's
+//	frames are given back.
+//
+//	"image" -- an image returned by Get
+//	"space" -- the address space it was returned to
+//----------------------------------------------------------------------
+
+void
+ImageCache::Put(Image *image, AddrSpace *space)
+{
+    ASSERT(image->users->IsInList(space));
+    image->users->Remove(space);
+    if (image->users->IsEmpty()) {
+	if (image->Sector() != -1)
+	    table->Remove(image->Sector());
+	delete image;
+    }
+}
@@ -0,0 +1,140 @@
+// image.h 
+//	Data structures for sharing the pages of an executable between
+//	the address spaces running it.
+//
+//	The pages of a program that come from its executable -- code,
+//	read-only data and initialized data -- start out the same in
+//	every address space running the program.  So rather than each
+//	address space reading them into frames of its own, the kernel
+//	keeps one Image per executable file in use, which reads each such
+//	page into a frame once, and every address space maps that frame.
+//
+//	The frame is mapped read-only.  Code is never written, so it
+//	stays shared; the first write to a data page makes a private copy
+//	of it for the address space that wrote it (copy on write).
+//
+//	An Image's pages are clean -- they are always exactly what the
+//	executable holds -- so when the frame table takes one of its
+//	frames, the page is simply dropped from every address space
+//	mapping it, and read again from the executable the next time one
+//	touches it.
+//
+//	Loading a page is cheap because the image keeps what it learned
+//	from the executable: the NOFF header is parsed once, into a few
+//	extents -- runs of the file that go to consecutive virtual
+//	addresses -- and the executable is read a window of several
+//	sectors at a time, so the pages a starting program faults in one
+//	after another mostly come out of memory.  The cache of images
+//	also remembers which file name each came from, so that running a
+//	program that is already running doesn't even look the name up.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include "copyright.h"
+#include "frametable.h"
+#include "filesys.h"
+#include "noff.h"
+#include "hash.h"
+#include "list.h"
+
+class AddrSpace;
+
+// A run of the executable that is loaded at consecutive virtual
+// addresses: a NOFF segment, or several that are back to back both
+// in the file and in the address space, as code, read-only data and
+// initialized data usually are.
+
+class Extent {
+  public:
+    int virtualAddr;			// where the run is loaded
+    int inFileAddr;			// where it is in the executable
+    int size;				// how many bytes
+};
+
+#define MaxExtents	3		// one for each kind of segment
+#define WindowSize	(max(divRoundUp(8 * PageSize, SectorSize), 2) * SectorSize)
+					// how much of the executable is read
+					// at a time: whole sectors, at least
+					// a page more than one sector
+
+// The following class defines the image of one executable, shared by
+// the address spaces running it.  Pages are numbered as in the address
+// spaces: page "vpn" of the image is virtual page "vpn" of each.
+
+class Image : public PageOwner {
+  public:
+    Image(char *fileName, OpenFile *file);
+					// Read the NOFF header of "file",
+					// which the image keeps open
+    ~Image();				// Give back the frames, and close
+					// the executable
+
+    NoffHeader *Header() { return &noffH; }
+    int NumPages() { return numPages; }	// Pages with something from the
+					// executable in them
+    int Sector() { return sector; }	// Identifies the executable
+    char *Name() { return name; }	// File name it was loaded by
+
+    int GetPage(int vpn);		// Frame holding page "vpn", read in
+					// if need be; caller holds the
+					// frame table lock
+
+    bool TestAndClearUse(int vpn);	// Did any address space use page
+					// "vpn" since the last call?
+    void PageOut(int vpn);		// Drop page "vpn" from memory
+
+  private:
+    OpenFile *executable;		// Where the pages come from
+    char *name;				// The name it was opened by
+    NoffHeader noffH;			// Layout of the executable
+    Extent extent[MaxExtents];		// What is loaded where, in order
+    int numExtents;
+    char *window;			// Part of the executable read last
+    int windowStart;			// Where it starts in the file
+    int windowLength;			// How much of it there is
+    int sector;				// Header sector of the executable,
+					// or -1 if it isn't on the Nachos disk
+    int numPages;			// Pages in the image
+    int *frame;				// Frame holding each page, or -1
+    List<AddrSpace *> *users;		// Address spaces running the image
+
+    void AddExtent(Segment *seg);	// Add "seg" to the extents
+    void LoadPage(int vpn, char *into);	// Read page "vpn" of the executable
+    void ReadExecutable(char *into, int numBytes, int position);
+					// Copy bytes of the executable, out
+					// of the window if they are in it
+
+    friend class ImageCache;
+};
+
+// The following class defines the table of the images in use, by the
+// header sector of their executable, so that loading a program that is
+// already running shares its image.  An image is found by the name it
+// was loaded by, too: while it is in use its executable is open, so
+// the file can't be removed, and the name still means the same file.
+
+class ImageCache {
+  public:
+    ImageCache();			// Initialize an empty table
+    ~ImageCache();			// De-allocate the table
+
+    Image *Get(char *fileName, AddrSpace *space);
+					// Return the image of the executable
+					// "fileName", for "space" to run;
+					// NULL if there is no such file
+    void Put(Image *image, AddrSpace *space);
+					// "space" is done with "image"; the
+					// caller holds the frame table lock
+
+  private:
+    HashTable<int, Image *> *table;	// Images in use, by sector
+
+    Image *FindByName(char *fileName);	// The image loaded by "fileName"
+};
+
+#endif // IMAGE_H
@@ -68,4 +68,51 @@ int SysRead(char *buffer, int size, OpenFileId fd)
 	return kernel->interrupt->ReadFile(buffer, size, fd);
 }
 
+// -1: write fail
+// size
+int SysPWrite(char *buffer, int size, int position, OpenFileId fd)
+{
+	return kernel->interrupt->PWriteFile(buffer, size, position, fd);
+}
+
+// -1: read fail
+// size
+int SysPRead(char *buffer, int size, int position, OpenFileId fd)
+{
+	return kernel->interrupt->PReadFile(buffer, size, position, fd);
+}
+
+// 1: seek success
+// -1: seek fail
+int SysSeek(int position, OpenFileId fd)
+{
+	return kernel->interrupt->SeekFile(position, fd);
+}
+
+// -1: map fail
+// address of the mapping
+int SysMmap(OpenFileId fd, int offset, int length)
+{
+	AddrSpace *space = kernel->currentThread->space;
+	OpenFile *file = space->FileTable()->Get(fd);
+
+	if (file == NULL)
+		return -1;
+	return space->Mmap(file, offset, length);
+}
+
+// 1: unmap success
+// -1: unmap fail
+int SysMunmap(int addr)
+{
+	return kernel->currentThread->space->Munmap(addr) ? 1 : -1;
+}
+
+// 1: remove success
+// 0: remove fail
+int SysRemove(char *filename)
+{
+	return kernel->interrupt->RemoveFile(filename);
+}
+
 #endif /* ! __USERPROG_KSYSCALL_H__ */
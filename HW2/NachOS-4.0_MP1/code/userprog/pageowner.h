@@ -0,0 +1,30 @@
+// pageowner.h 
+//	Interface between the frame table and whatever the pages in the
+//	frames belong to.
+//
+//	A frame of main memory holds a page of an address space, or a
+//	page of the image of an executable that several address spaces
+//	share (see image.h).  The frame table asks the owner about the
+//	page while it looks for a victim, and has the owner page it out
+//	once one is chosen.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PAGEOWNER_H
+#define PAGEOWNER_H
+
+#include "copyright.h"
+
+class PageOwner {
+  public:
+    virtual ~PageOwner() {}
+
+    virtual bool TestAndClearUse(int page) = 0;
+					// Was "page" used since the last
+					// call?  Clear its use bit
+    virtual void PageOut(int page) = 0;	// Give up the frame "page" is in
+};
+
+#endif // PAGEOWNER_H
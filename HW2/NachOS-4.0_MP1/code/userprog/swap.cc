@@ -0,0 +1,103 @@
+// swap.cc 
+//	Routines to move pages of user programs between main memory
+//	and the swap area on the simulated disk.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "swap.h"
+#include "main.h"
+#include "machine.h"
+#include "synchdisk.h"
+
+//----------------------------------------------------------------------
+// SwapSpace::SwapSpace
+// 	Initialize a swap area with every slot free.  Nothing survives
+//	in swap from one run of Nachos to the next.
+//----------------------------------------------------------------------
+
+SwapSpace::SwapSpace()
+{
+    ASSERT(PageSize <= SectorSize);	// a page must fit in a sector
+    ASSERT(SwapFirstSector > 0);
+    slots = new Bitmap(NumSwapSectors);
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::~SwapSpace
+// 	De-allocate the map of swap slots.
+//----------------------------------------------------------------------
+
+SwapSpace::~SwapSpace()
+{
+    delete slots;
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::Allocate
+// 	Find a free swap slot and mark it in use.  Return -1 if every
+//	slot is taken.
+//----------------------------------------------------------------------
+
+int
+SwapSpace::Allocate()
+{
+    return slots->FindAndSet();
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::Free
+// 	Give back a slot whose page is no longer needed.
+//
+//	"slot" -- a slot returned by Allocate
+//----------------------------------------------------------------------
+
+void
+SwapSpace::Free(int slot)
+{
+    ASSERT(slots->Test(slot));
+    slots->Clear(slot);
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::ReadPage
+// 	Read the page saved in "slot" into "into", a frame of main
+//	memory.  Returns only once the disk is done.
+//
+//	"slot" -- the slot the page was written to
+//	"into" -- where to put the page
+//----------------------------------------------------------------------
+
+void
+SwapSpace::ReadPage(int slot, char *into)
+{
+    DiskLayerScope scope(LayerSwap);
+    char sector[SectorSize];
+
+    ASSERT(slots->Test(slot));
+    kernel->synchDisk->ReadSector(SwapFirstSector + slot, sector);
+    bcopy(sector, into, PageSize);
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::WritePage
+// 	Write "from", a frame of main memory, out to "slot".  The rest of
+//	the sector, if it is bigger than a page, is zeroed.
+//
+//	"slot" -- a slot returned by Allocate
+//	"from" -- the page to save
+//----------------------------------------------------------------------
+
+void
+SwapSpace::WritePage(int slot, char *from)
+{
+    DiskLayerScope scope(LayerSwap);
+    char sector[SectorSize];
+
+    ASSERT(slots->Test(slot));
+    bzero(sector, SectorSize);
+    bcopy(from, sector, PageSize);
+    kernel->synchDisk->WriteSector(SwapFirstSector + slot, sector);
+}
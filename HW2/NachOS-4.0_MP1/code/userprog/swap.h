@@ -0,0 +1,48 @@
+// swap.h 
+//	Data structures to manage the swap area, where pages of user
+//	programs live while the frames they were in are being used by
+//	someone else.
+//
+//	The swap area is a fixed run of sectors at the end of the
+//	simulated disk, one page per sector.  When the file system
+//	formats the disk it marks these sectors as in use, so no file
+//	is ever given one of them.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SWAP_H
+#define SWAP_H
+
+#include "copyright.h"
+#include "bitmap.h"
+#include "disk.h"
+
+const int NumSwapSectors = 4096;	// 512KB of swap with 128 byte pages
+const int SwapFirstSector = NumSectors - NumSwapSectors;
+
+// The following class keeps track of which swap slots (sectors in
+// the swap area) hold a page, and moves pages between memory and
+// the disk.
+
+class SwapSpace {
+  public:
+    SwapSpace();			// Initialize an empty swap area
+    ~SwapSpace();			// De-allocate the swap map
+
+    int Allocate();			// Find a free slot for a page;
+					// return -1 if swap is full
+    void Free(int slot);		// Give a slot back
+
+    void ReadPage(int slot, char *into);
+					// Read the page in "slot" into
+					// a frame of main memory
+    void WritePage(int slot, char *from);
+					// Write a frame out to "slot"
+
+  private:
+    Bitmap *slots;			// which slots are in use
+};
+
+#endif // SWAP_H
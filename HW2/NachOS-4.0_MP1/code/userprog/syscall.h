@@ -37,6 +37,12 @@
 #define SC_Add		42
 #define SC_MSG		100
 #define SC_PrintInt 16
+#define SC_ReadV	17
+#define SC_WriteV	18
+#define SC_PRead	19
+#define SC_PWrite	20
+#define SC_Mmap		21
+#define SC_Munmap	22
 
 #ifndef IN_ASM
 
@@ -123,7 +129,9 @@ typedef int OpenFileId;
 /* Return 1 on success, negative error code on failure */
 int Create(char *name, int initialSize);
 
-/* Remove a Nachos file, with name "name" */
+/* Remove a Nachos file, with name "name".
+ * Return 1 on success, 0 if there is no such file or it is still open.
+ */
 int Remove(char *name);
 
 /* Open the Nachos file "name", and return an "OpenFileId" that can 
@@ -145,8 +153,51 @@ int Write(char *buffer, int size, OpenFileId id);
  */
 int Read(char *buffer, int size, OpenFileId id);
 
+/* One buffer of a vectored ReadV/WriteV. */
+typedef struct {
+    char *buffer;	/* where the bytes are */
+    int size;		/* how many of them */
+} IoVec;
+
+#define MaxIoVec	16	/* most buffers one ReadV/WriteV takes */
+
+/* Read into "count" buffers, filling each in turn, or write "count"
+ * buffers, one after another, with a single system call.  The open
+ * file is read or written in one piece, from the current position, so
+ * this is much cheaper than a Read or Write for every buffer.
+ * Return the total number of bytes transferred, or -1 if "id" isn't
+ * open or "count" is not between 0 and MaxIoVec.
+ */
+int ReadV(IoVec *iov, int count, OpenFileId id);
+int WriteV(IoVec *iov, int count, OpenFileId id);
+
+/* Read/write "size" bytes at byte "position" of the open file,
+ * without using or changing its seek position.
+ * Return the number of bytes transferred, or -1 if "id" isn't open.
+ */
+int PRead(char *buffer, int size, int position, OpenFileId id);
+int PWrite(char *buffer, int size, int position, OpenFileId id);
+
+/* Map "length" bytes of the open file "id", from byte "offset" on,
+ * into the address space, and return the address they are mapped at.
+ * The file is read a page at a time, as the program touches it, and
+ * the pages the program writes go back to the file when it calls
+ * Munmap or exits.  "offset" must be a multiple of the page size;
+ * the mapping stops at the end of the file.  It stays good after the
+ * file is closed.
+ * Return -1 if "id" isn't open or "offset" or "length" is no good.
+ */
+char *Mmap(OpenFileId id, int offset, int length);
+
+/* Remove the mapping at "addr", an address Mmap returned, writing
+ * back what the program changed.
+ * Return 1 on success, -1 if there is no mapping at "addr".
+ */
+int Munmap(char *addr);
+
 /* Set the seek position of the open file "id"
  * to the byte "position".
+ * Return 1 on success, -1 if "id" isn't open or "position" is negative.
  */
 int Seek(int position, OpenFileId id);
 
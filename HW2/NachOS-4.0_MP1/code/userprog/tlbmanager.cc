@@ -0,0 +1,199 @@
+// tlbmanager.cc 
+//	Routines to refill and empty the machine's software-loaded TLB.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "tlbmanager.h"
+#include "main.h"
+#include "sysdep.h"
+#include "debug.h"
+
+//----------------------------------------------------------------------
+// TlbManager::TlbManager
+// 	Initialize the manager of the machine's TLB, which must exist.
+//
+//	"policyName" -- "random", "lru" or "clock": how to choose the
+//		entry a refill replaces
+//----------------------------------------------------------------------
+
+TlbManager::TlbManager(char *policyName)
+{
+    Machine *machine = kernel->machine;
+    int numSets;
+
+    ASSERT(machine->tlb != NULL);
+    if (strcmp(policyName, "random") == 0) {
+	policy = TlbRandom;
+    } else if (strcmp(policyName, "lru") == 0) {
+	policy = TlbLRU;
+    } else if (strcmp(policyName, "clock") == 0) {
+	policy = TlbClock;
+    } else {
+	cerr << "Unknown TLB replacement policy " << policyName << "\n";
+	ASSERTNOTREACHED();
+    }
+    numSets = machine->tlbSize / machine->tlbWays;
+    hand = new int[numSets];
+    for (int i = 0; i < numSets; i++)
+	hand[i] = 0;
+}
+
+//----------------------------------------------------------------------
+// TlbManager::~TlbManager
+// 	De-allocate the TLB manager.
+//----------------------------------------------------------------------
+
+TlbManager::~TlbManager()
+{
+    delete [] hand;
+}
+
+//----------------------------------------------------------------------
+// TlbManager::Refill
+// 	Load the translation for virtual page "vpn" into the TLB, after
+//	a reference to it missed.  The page must be in memory.  The new
+//	entry starts with its use and dirty bits clear; the page table
+//	entry keeps whatever it had.
+//
+//	"pageTable" -- the page table of the current address space
+//	"vpn" -- the virtual page that missed
+//----------------------------------------------------------------------
+
+void
+TlbManager::Refill(TranslationEntry *pageTable, int vpn)
+{
+    Machine *machine = kernel->machine;
+    int victim = Victim(pageTable, machine->TlbSet(vpn));
+    TranslationEntry *entry = &machine->tlb[victim];
+
+    ASSERT(pageTable[vpn].valid);
+    if (entry->valid) {
+	DEBUG(dbgAddr, "TLB entry " << victim << " replaced, page " 
+	      << entry->virtualPage);
+	WriteBack(pageTable, entry);
+	machine->InvalidateHostPage(entry->virtualPage);
+    }
+    *entry = pageTable[vpn];
+    entry->use = FALSE;
+    entry->dirty = FALSE;
+    machine->tlbLastUse[victim] = kernel->stats->numTlbHits;
+    kernel->stats->numTlbRefills++;
+}
+
+//----------------------------------------------------------------------
+// TlbManager::Flush
+// 	Empty the TLB, copying the use and dirty bits of every entry back
+//	to the page table it was loaded from.  Called when the address
+//	space it belongs to stops running.
+//
+//	"pageTable" -- the page table of the current address space
+//----------------------------------------------------------------------
+
+void
+TlbManager::Flush(TranslationEntry *pageTable)
+{
+    Machine *machine = kernel->machine;
+
+    for (int i = 0; i < machine->tlbSize; i++) {
+	if (machine->tlb[i].valid) {
+	    WriteBack(pageTable, &machine->tlb[i]);
+	    machine->tlb[i].valid = FALSE;
+	}
+    }
+    machine->FlushHostCache();
+}
+
+//----------------------------------------------------------------------
+// TlbManager::FlushPage
+// 	Drop virtual page "vpn" from the TLB, copying its use and dirty
+//	bits back to the page table.  The kernel calls this before it
+//	changes the page table entry of a page of the current address
+//	space, so the hardware doesn't go on using a stale copy.
+//
+//	"pageTable" -- the page table of the current address space
+//	"vpn" -- the virtual page to drop
+//----------------------------------------------------------------------
+
+void
+TlbManager::FlushPage(TranslationEntry *pageTable, int vpn)
+{
+    Machine *machine = kernel->machine;
+    int set = machine->TlbSet(vpn);
+
+    for (int i = set; i < set + machine->tlbWays; i++) {
+	if (machine->tlb[i].valid && machine->tlb[i].virtualPage == vpn) {
+	    WriteBack(pageTable, &machine->tlb[i]);
+	    machine->tlb[i].valid = FALSE;
+	}
+    }
+    machine->InvalidateHostPage(vpn);
+}
+
+//----------------------------------------------------------------------
+// TlbManager::Victim
+// 	Return the entry of the TLB set starting at "set" that a refill
+//	should replace: an empty one if there is one, otherwise the one
+//	the replacement policy picks.
+//
+//	"pageTable" -- the page table of the current address space
+//	"set" -- the first TLB entry of the set
+//----------------------------------------------------------------------
+
+int
+TlbManager::Victim(TranslationEntry *pageTable, int set)
+{
+    Machine *machine = kernel->machine;
+    int ways = machine->tlbWays;
+    int i, oldest;
+
+    for (i = set; i < set + ways; i++) {
+	if (!machine->tlb[i].valid)
+	    return i;
+    }
+    switch (policy) {
+      case TlbRandom:
+	return set + RandomNumber() % ways;
+      case TlbLRU:
+	oldest = set;
+	for (i = set + 1; i < set + ways; i++) {
+	    if (machine->tlbLastUse[i] < machine->tlbLastUse[oldest])
+		oldest = i;
+	}
+	return oldest;
+      case TlbClock:
+	for (;;) {
+	    i = set + hand[set / ways];
+	    hand[set / ways] = (hand[set / ways] + 1) % ways;
+	    if (!machine->tlb[i].use)
+		return i;
+	    WriteBack(pageTable, &machine->tlb[i]);	// the page table
+	    machine->tlb[i].use = FALSE;		// keeps the use bit
+	}
+    }
+    ASSERTNOTREACHED();
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// TlbManager::WriteBack
+// 	Copy the use and dirty bits the hardware set in a TLB entry to
+//	the page table entry of the same page.  They are only ever set,
+//	so the bits in the page table stay set too.
+//
+//	"pageTable" -- the page table the entry was loaded from
+//	"entry" -- the TLB entry
+//----------------------------------------------------------------------
+
+void
+TlbManager::WriteBack(TranslationEntry *pageTable, TranslationEntry *entry)
+{
+    TranslationEntry *pte = &pageTable[entry->virtualPage];
+
+    if (entry->use)
+	pte->use = TRUE;
+    if (entry->dirty)
+	pte->dirty = TRUE;
+}
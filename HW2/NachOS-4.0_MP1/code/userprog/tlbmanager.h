@@ -0,0 +1,61 @@
+// tlbmanager.h 
+//	Data structures for the kernel's half of a software-loaded TLB.
+//
+//	When the machine is built with a TLB (see Machine::Translate),
+//	it never walks a page table itself: a reference that misses in
+//	the TLB raises a PageFaultException, and the kernel loads the
+//	translation from the current address space's page table into
+//	some entry of the TLB, then retries the instruction.  Which entry
+//	to give up is the replacement policy:
+//
+//	   random -- any entry of the set, as the MIPS R2000 does
+//	   lru -- the entry of the set used longest ago
+//	   clock -- the next entry of the set, in turn, whose use
+//		bit is clear; entries passed over lose their use bit
+//
+//	The TLB isn't tagged with address spaces, so it is emptied on
+//	every context switch.  While a page is in the TLB, the use and
+//	dirty bits the hardware sets are in the TLB entry; they are
+//	copied back to the page table whenever the entry is given up.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#ifndef TLBMANAGER_H
+#define TLBMANAGER_H
+
+#include "copyright.h"
+#include "translate.h"
+
+enum TlbPolicy { TlbRandom, TlbLRU, TlbClock };
+
+class TlbManager {
+  public:
+    TlbManager(char *policyName);	// Manage the machine's TLB, with
+					// policy "random", "lru" or "clock"
+    ~TlbManager();			// De-allocate the manager
+
+    void Refill(TranslationEntry *pageTable, int vpn);
+					// Load the translation for page
+					// "vpn" into the TLB, after a miss
+    void Flush(TranslationEntry *pageTable);
+					// Empty the TLB, on a context switch
+    void FlushPage(TranslationEntry *pageTable, int vpn);
+					// Drop page "vpn" from the TLB, if
+					// it is there, before its page table
+					// entry is changed
+
+  private:
+    TlbPolicy policy;			// which entry a refill replaces
+    int *hand;				// for each set, the next entry the
+					// clock policy looks at
+
+    int Victim(TranslationEntry *pageTable, int set);
+					// Pick the entry of "set" to replace
+    void WriteBack(TranslationEntry *pageTable, TranslationEntry *entry);
+					// Copy the use and dirty bits of a
+					// TLB entry to the page table
+};
+
+#endif // TLBMANAGER_H